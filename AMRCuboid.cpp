@@ -0,0 +1,1079 @@
+#include "AMRCuboid.h"
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+#include "ChemSpecies.h"
+#include "Mesh.h"
+#include "Log.h"
+#include "PropertyTable.h"
+#include "Reductions.h"
+#include "heateqn_solver.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+// settings for the coarse mesh, which has twice the spacing of the mesh in settings.conf
+static ConfFileData coarsened(ConfFileData const& conf_file_data)
+{
+	ConfFileData coarse_conf_file_data = conf_file_data;
+	coarse_conf_file_data._x_meshsize = (conf_file_data._x_meshsize - 1) / 2 + 1;
+	coarse_conf_file_data._y_meshsize = (conf_file_data._y_meshsize - 1) / 2 + 1;
+	coarse_conf_file_data._z_meshsize = (conf_file_data._z_meshsize - 1) / 2 + 1;
+	return coarse_conf_file_data;
+}
+
+AMRCuboid::AMRCuboid(ConfFileData& cf, CSVFileData& csv_file_data, PropertyTable const& property_table)
+	: _property_table(property_table),
+	_kinetics(csv_file_data._chem_array),
+	_coarse_conf_file_data(coarsened(cf)),
+	_coarse_temp(_coarse_conf_file_data, "amr_coarse_temp"),
+	_new_coarse_temp(_coarse_temp, "amr_coarse_temp")
+{
+	// chemistry
+	_chemistry_on = cf._chemistry_on;
+	_chem_species_array = csv_file_data._chem_array;
+	for (auto& species : _chem_species_array)
+	{
+		_species_heat.push_back(species.alpha() * (cf._TOC / 100) * cf._kerogen_density);
+	}
+
+	// refinement criteria
+	_refine_temp_jump = cf._amr_refine_temp_jump;
+	_refine_chem_rate = cf._amr_refine_chem_rate;
+
+	// fine and coarse meshes
+	_fine_size[0] = cf._x_meshsize;
+	_fine_size[1] = cf._y_meshsize;
+	_fine_size[2] = cf._z_meshsize;
+	_fine_spacing[0] = cf._x_length / (1000000 * (cf._x_meshsize - 1));
+	_fine_spacing[1] = cf._y_length / (1000000 * (cf._y_meshsize - 1));
+	_fine_spacing[2] = cf._z_length / (1000000 * (cf._z_meshsize - 1));
+	_coarse_size[0] = _coarse_conf_file_data._x_meshsize;
+	_coarse_size[1] = _coarse_conf_file_data._y_meshsize;
+	_coarse_size[2] = _coarse_conf_file_data._z_meshsize;
+
+	_initial_temp = cf._initial_temp + 273.15;
+	_coarse_temp.fill(_initial_temp);
+	_new_coarse_temp.fill(_initial_temp);
+	if (_chemistry_on)
+	{
+		for (size_t species = 0; species < _chem_species_array.size(); species++)
+		{
+			_coarse_chem.push_back(CuboidMesh(_coarse_temp, "amr_coarse_chem" + std::to_string(species + 1)));
+			_coarse_chem[species].fill(1.0);
+		}
+	}
+	_boundary_temp = _initial_temp;
+
+	// blocks, all coarse to begin with
+	_block_size = cf._amr_block_size;
+	_block_span = 2 * _block_size;
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		_blocks[axis] = (_coarse_size[axis] - 1) / _block_size;
+	}
+	_local_size = _block_span + 3;
+	_fine_blocks.resize(_blocks[0] * _blocks[1] * _blocks[2]);
+	find_interface();
+}
+
+/*
+Index helpers
+Points of a block are stored at positions s = 1, ..., owned_end along each axis, with halo points at s = 0 and
+s = owned_end + 1. Block b owns the fine points b * _block_span + s - 1; the last block along each axis also owns
+the far face of the cuboid, so every fine point has exactly one owner.
+*/
+
+size_t AMRCuboid::block_index(size_t const bx, size_t const by, size_t const bz) const
+{
+	return (bx * _blocks[1] + by) * _blocks[2] + bz;
+}
+size_t AMRCuboid::local_index(size_t const sx, size_t const sy, size_t const sz) const
+{
+	return (sx * _local_size + sy) * _local_size + sz;
+}
+size_t AMRCuboid::coarse_index(size_t const i, size_t const j, size_t const k) const
+{
+	return (i * _coarse_size[1] + j) * _coarse_size[2] + k;
+}
+size_t AMRCuboid::owned_end(size_t const axis, size_t const b) const
+{
+	return (b == _blocks[axis] - 1) ? _block_span + 1 : _block_span;
+}
+size_t AMRCuboid::owner(size_t const axis, size_t const g) const
+{
+	return std::min(g / _block_span, _blocks[axis] - 1);
+}
+// the block owning fine point g, and the point's index in that block's arrays
+size_t AMRCuboid::fine_location(size_t const g[3], size_t& local) const
+{
+	size_t b[3];
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		b[axis] = owner(axis, g[axis]);
+	}
+	local = local_index(g[0] - b[0] * _block_span + 1, g[1] - b[1] * _block_span + 1, g[2] - b[2] * _block_span + 1);
+	return block_index(b[0], b[1], b[2]);
+}
+size_t AMRCuboid::number_of_blocks() const
+{
+	return _fine_blocks.size();
+}
+size_t AMRCuboid::coarse_mesh_size() const
+{
+	return _coarse_temp.size();
+}
+ConfFileData& AMRCuboid::coarse_conf_file_data()
+{
+	return _coarse_conf_file_data;
+}
+CuboidMesh const& AMRCuboid::coarse_temp() const
+{
+	return _coarse_temp;
+}
+
+/*
+Coarse-fine interface
+A fine point is inside the refined region if every block whose closed box holds it is refined; points on the
+planes between blocks belong to the boxes on both sides. The surface of the refined region lies on coarse mesh
+planes, and a coarse point is inside, on the surface or outside according to the fine point it coincides with.
+*/
+
+bool AMRCuboid::on_faces(size_t const g[3]) const
+{
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		if (g[axis] == 0 or g[axis] == _fine_size[axis] - 1)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// number of blocks whose closed box holds fine point g, setting refined to how many of them are refined
+size_t AMRCuboid::blocks_around(size_t const g[3], size_t& refined) const
+{
+	size_t first[3];
+	size_t last[3];
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		last[axis] = owner(axis, g[axis]);
+		first[axis] = (g[axis] % _block_span == 0 and g[axis] > 0) ? g[axis] / _block_span - 1 : last[axis];
+	}
+	refined = 0;
+	for (size_t bx = first[0]; bx <= last[0]; bx++)
+	{
+		for (size_t by = first[1]; by <= last[1]; by++)
+		{
+			for (size_t bz = first[2]; bz <= last[2]; bz++)
+			{
+				refined += _fine_blocks[block_index(bx, by, bz)].refined;
+			}
+		}
+	}
+	return (last[0] - first[0] + 1) * (last[1] - first[1] + 1) * (last[2] - first[2] + 1);
+}
+bool AMRCuboid::refined_interior(size_t const g[3]) const
+{
+	size_t refined;
+	return blocks_around(g, refined) == refined;
+}
+bool AMRCuboid::on_interface(size_t const g[3]) const
+{
+	size_t refined;
+	size_t const around = blocks_around(g, refined);
+	return refined > 0 and refined < around and not on_faces(g);
+}
+
+// sort the coarse points into those inside the refined region and those on its surface, and list the fine fluxes
+// across the surface: every fine point on the surface is interpolated from the coarse points of the surface
+// around it (weight 1/2 along each axis where it is a midpoint), and its flux into each neighbouring fine point
+// inside the refined region is taken from those coarse points with the same weights
+void AMRCuboid::find_interface()
+{
+	size_t const coarse_size = _coarse_temp.size();
+	size_t const stride[3] = { _local_size * _local_size, _local_size, 1 };
+	_covered.assign(coarse_size, 0);
+	_covered_points.clear();
+	_interface_points.clear();
+	_interface_starts.clear();
+	_interface_fluxes.clear();
+
+	for (size_t index = 0; index < coarse_size; index++)
+	{
+		size_t const g[3] = { 2 * (index / (_coarse_size[1] * _coarse_size[2])),
+			2 * ((index / _coarse_size[2]) % _coarse_size[1]), 2 * (index % _coarse_size[2]) };
+		if (on_faces(g))
+		{
+			continue;
+		}
+		if (refined_interior(g))
+		{
+			_covered[index] = 1;
+			_covered_points.push_back(index);
+			continue;
+		}
+		if (not on_interface(g))
+		{
+			continue;
+		}
+
+		_interface_points.push_back(index);
+		_interface_starts.push_back(_interface_fluxes.size());
+		for (size_t offset = 0; offset < 27; offset++)
+		{
+			size_t const d[3] = { offset / 9, (offset / 3) % 3, offset % 3 };
+			size_t const p[3] = { g[0] + d[0] - 1, g[1] + d[1] - 1, g[2] + d[2] - 1 };
+			if (not on_interface(p))
+			{
+				continue;
+			}
+			double weight = 1.0;
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				weight *= (d[axis] == 1) ? 1.0 : 0.5;
+			}
+
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				for (size_t side = 0; side < 2; side++)
+				{
+					size_t f[3] = { p[0], p[1], p[2] };
+					f[axis] = (side == 0) ? p[axis] - 1 : p[axis] + 1;
+					if (on_faces(f) or not refined_interior(f))
+					{
+						continue;
+					}
+					size_t local;
+					size_t const block = fine_location(f, local);
+					size_t const neighbour = (side == 0) ? local + stride[axis] : local - stride[axis];
+					_interface_fluxes.push_back({ block, local, neighbour, axis, weight });
+				}
+			}
+		}
+	}
+	_interface_starts.push_back(_interface_fluxes.size());
+	_interface_heat.assign(_interface_points.size(), 0.0);
+}
+
+/*
+Transfers between levels
+*/
+
+// trilinear interpolation of a coarse mesh at fine point g
+double AMRCuboid::coarse_interpolate(Mesh const& coarse, size_t const g[3]) const
+{
+	double value = 0.0;
+	for (size_t corner = 0; corner < 8; corner++)
+	{
+		double weight = 1.0;
+		size_t c[3];
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			size_t const bit = (corner >> axis) & 1;
+			bool const midpoint = (g[axis] % 2 == 1);
+			if (bit == 1 and not midpoint)
+			{
+				weight = 0.0;
+				break;
+			}
+			weight *= midpoint ? 0.5 : 1.0;
+			c[axis] = g[axis] / 2 + bit;
+		}
+		if (weight > 0.0)
+		{
+			value += weight * coarse[coarse_index(c[0], c[1], c[2])];
+		}
+	}
+	return value;
+}
+
+// value at fine point g, which must be owned by a refined block
+double AMRCuboid::fine_value(size_t const g[3]) const
+{
+	size_t local;
+	size_t const b = fine_location(g, local);
+	return _fine_blocks[b].temp[local];
+}
+
+// fill the halo of block b from neighbouring refined blocks, or from the coarse mesh at time fraction theta
+// through the coarse timestep
+void AMRCuboid::fill_halo(size_t const b, double const theta)
+{
+	FineBlock& block = _fine_blocks[b];
+	size_t const bc[3] = { b / (_blocks[1] * _blocks[2]), (b / _blocks[2]) % _blocks[1], b % _blocks[2] };
+	size_t const end[3] = { owned_end(0, bc[0]), owned_end(1, bc[1]), owned_end(2, bc[2]) };
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		size_t const axis1 = (axis + 1) % 3;
+		size_t const axis2 = (axis + 2) % 3;
+		for (size_t side : { size_t(0), end[axis] + 1 })
+		{
+			// no halo is needed on the faces of the cuboid
+			if ((side == 0 and bc[axis] == 0) or (side != 0 and bc[axis] == _blocks[axis] - 1))
+			{
+				continue;
+			}
+
+			size_t s[3];
+			s[axis] = side;
+			for (s[axis1] = 1; s[axis1] <= end[axis1]; s[axis1]++)
+			{
+				for (s[axis2] = 1; s[axis2] <= end[axis2]; s[axis2]++)
+				{
+					size_t const g[3] = { bc[0] * _block_span + s[0] - 1, bc[1] * _block_span + s[1] - 1,
+						bc[2] * _block_span + s[2] - 1 };
+					size_t const neighbour = block_index(owner(0, g[0]), owner(1, g[1]), owner(2, g[2]));
+
+					double value;
+					if (_fine_blocks[neighbour].refined)
+					{
+						value = fine_value(g);
+					}
+					else
+					{
+						value = (1 - theta) * coarse_interpolate(_coarse_temp, g)
+							+ theta * coarse_interpolate(_new_coarse_temp, g);
+					}
+					block.temp[local_index(s[0], s[1], s[2])] = value;
+				}
+			}
+		}
+	}
+}
+
+// set the points of block b on the surface of the refined region from the coarse mesh
+void AMRCuboid::fill_interface(size_t const b)
+{
+	FineBlock& block = _fine_blocks[b];
+	size_t const bc[3] = { b / (_blocks[1] * _blocks[2]), (b / _blocks[2]) % _blocks[1], b % _blocks[2] };
+	size_t const end[3] = { owned_end(0, bc[0]), owned_end(1, bc[1]), owned_end(2, bc[2]) };
+
+	for (size_t sx = 1; sx <= end[0]; sx++)
+	{
+		for (size_t sy = 1; sy <= end[1]; sy++)
+		{
+			for (size_t sz = 1; sz <= end[2]; sz++)
+			{
+				size_t const g[3] = { bc[0] * _block_span + sx - 1, bc[1] * _block_span + sy - 1,
+					bc[2] * _block_span + sz - 1 };
+				if (on_interface(g))
+				{
+					block.temp[local_index(sx, sy, sz)] = coarse_interpolate(_coarse_temp, g);
+				}
+			}
+		}
+	}
+}
+
+// set coarse point index inside the refined region to the volume-weighted average of the fine points around it:
+// its control volume holds the coinciding fine point's, half of each face neighbour's, a quarter of each edge
+// neighbour's and an eighth of each corner neighbour's
+void AMRCuboid::restrict_to_coarse(size_t const index)
+{
+	size_t const g[3] = { 2 * (index / (_coarse_size[1] * _coarse_size[2])),
+		2 * ((index / _coarse_size[2]) % _coarse_size[1]), 2 * (index % _coarse_size[2]) };
+	double weights[27];
+	FineBlock const* blocks[27];
+	size_t locals[27];
+	double temp = 0.0;
+	for (size_t offset = 0; offset < 27; offset++)
+	{
+		size_t const d[3] = { offset / 9, (offset / 3) % 3, offset % 3 };
+		size_t const f[3] = { g[0] + d[0] - 1, g[1] + d[1] - 1, g[2] + d[2] - 1 };
+		weights[offset] = 0.125;
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			weights[offset] *= (d[axis] == 1) ? 1.0 : 0.5;
+		}
+		blocks[offset] = &_fine_blocks[fine_location(f, locals[offset])];
+		temp += weights[offset] * blocks[offset]->temp[locals[offset]];
+	}
+	_new_coarse_temp[index] = temp;
+
+	for (size_t species = 0; species < _coarse_chem.size(); species++)
+	{
+		double chem = 0.0;
+		for (size_t offset = 0; offset < 27; offset++)
+		{
+			chem += weights[offset] * blocks[offset]->chem[species][locals[offset]];
+		}
+		_coarse_chem[species][index] = chem;
+	}
+}
+
+// refine block b, interpolating its points from the coarse mesh
+// (trilinear interpolation keeps the trapezoidal integral of the fields, so no heat is gained or lost)
+void AMRCuboid::refine_block(size_t const b)
+{
+	FineBlock& block = _fine_blocks[b];
+	size_t const bc[3] = { b / (_blocks[1] * _blocks[2]), (b / _blocks[2]) % _blocks[1], b % _blocks[2] };
+	size_t const end[3] = { owned_end(0, bc[0]), owned_end(1, bc[1]), owned_end(2, bc[2]) };
+	size_t const local_points = _local_size * _local_size * _local_size;
+
+	block.temp.assign(local_points, 0.0);
+	block.new_temp.assign(local_points, 0.0);
+	block.chem.assign(_coarse_chem.size(), std::vector<double>(local_points, 0.0));
+
+	for (size_t sx = 1; sx <= end[0]; sx++)
+	{
+		for (size_t sy = 1; sy <= end[1]; sy++)
+		{
+			for (size_t sz = 1; sz <= end[2]; sz++)
+			{
+				size_t const g[3] = { bc[0] * _block_span + sx - 1, bc[1] * _block_span + sy - 1,
+					bc[2] * _block_span + sz - 1 };
+				size_t const index = local_index(sx, sy, sz);
+				block.temp[index] = coarse_interpolate(_coarse_temp, g);
+				for (size_t species = 0; species < _coarse_chem.size(); species++)
+				{
+					block.chem[species][index] = coarse_interpolate(_coarse_chem[species], g);
+				}
+			}
+		}
+	}
+	block.refined = true;
+}
+
+// coarsen block b; the coarse points it covers already hold the averages of its values, so its storage can be
+// released
+void AMRCuboid::coarsen_block(size_t const b)
+{
+	FineBlock& block = _fine_blocks[b];
+	std::vector<double>().swap(block.temp);
+	std::vector<double>().swap(block.new_temp);
+	std::vector<std::vector<double>>().swap(block.chem);
+	block.refined = false;
+}
+
+/*
+Timestepping
+Chemistry is integrated exactly for the temperature at the start of each timestep (c -> c exp(-k dt)), which
+stays stable on the coarse mesh, where the timestep is four times longer.
+*/
+
+template <typename F>
+double AMRCuboid::react(double const temp, F& chem, size_t const index, double const dt) const
+{
+	double chem_heat = 0.0;
+	_kinetics.for_each_k(temp, [&](size_t const species, double const k)
+	{
+		double const converted = -chem[species][index] * std::expm1(-k * dt);
+		chem[species][index] -= converted;
+		chem_heat -= _species_heat[species] * converted / dt;
+	});
+	return chem_heat;
+}
+
+bool AMRCuboid::update_block(size_t const b, double const dt, double const theta, double const boundary_temp)
+{
+	FineBlock& block = _fine_blocks[b];
+	size_t const bc[3] = { b / (_blocks[1] * _blocks[2]), (b / _blocks[2]) % _blocks[1], b % _blocks[2] };
+	size_t const end[3] = { owned_end(0, bc[0]), owned_end(1, bc[1]), owned_end(2, bc[2]) };
+	size_t const stride[3] = { _local_size * _local_size, _local_size, 1 };
+	double const inverse_h2[3] = { 1 / (_fine_spacing[0] * _fine_spacing[0]),
+		1 / (_fine_spacing[1] * _fine_spacing[1]), 1 / (_fine_spacing[2] * _fine_spacing[2]) };
+
+	bool non_finite = false;
+	for (size_t sx = 1; sx <= end[0]; sx++)
+	{
+		for (size_t sy = 1; sy <= end[1]; sy++)
+		{
+			for (size_t sz = 1; sz <= end[2]; sz++)
+			{
+				size_t const g[3] = { bc[0] * _block_span + sx - 1, bc[1] * _block_span + sy - 1,
+					bc[2] * _block_span + sz - 1 };
+				size_t const index = local_index(sx, sy, sz);
+				double const point_temp = block.temp[index];
+
+				bool const on_boundary = on_faces(g);
+
+				// only points on the planes between blocks can be on the surface of the refined region
+				bool const interface = not on_boundary and (g[0] % _block_span == 0 or g[1] % _block_span == 0
+					or g[2] % _block_span == 0) and on_interface(g);
+
+				double chem_heat = 0.0;
+				if (_chemistry_on)
+				{
+					chem_heat = react(point_temp, block.chem, index, dt);
+				}
+
+				if (on_boundary)
+				{
+					block.new_temp[index] = boundary_temp;
+				}
+				else if (interface)
+				{
+					block.new_temp[index] = (1 - theta) * coarse_interpolate(_coarse_temp, g)
+						+ theta * coarse_interpolate(_new_coarse_temp, g);
+				}
+				else
+				{
+					double laplacian = 0.0;
+					for (size_t axis = 0; axis < 3; axis++)
+					{
+						laplacian += (block.temp[index + stride[axis]] - 2 * point_temp
+							+ block.temp[index - stride[axis]]) * inverse_h2[axis];
+					}
+					block.new_temp[index] = point_temp
+						+ _property_table.thermal_diffusivity(point_temp) * dt * laplacian + dt * chem_heat;
+				}
+				non_finite = non_finite or not std::isfinite(block.new_temp[index]);
+			}
+		}
+	}
+	return non_finite;
+}
+
+double AMRCuboid::step(double const dt, double const boundary_increment, double& sum_of_square_changes,
+	bool& non_finite)
+{
+	double const coarse_dt = SUBCYCLES * dt;
+	size_t const coarse_size = _coarse_temp.size();
+	size_t const blocks = _fine_blocks.size();
+
+	// coarse timestep over the whole cuboid
+#pragma omp parallel for
+	for (size_t index = 0; index < coarse_size; index++)
+	{
+		double const point_temp = _coarse_temp[index];
+		double chem_heat = 0.0;
+		if (_chemistry_on)
+		{
+			chem_heat = react(point_temp, _coarse_chem, index, coarse_dt);
+		}
+
+		if (_coarse_temp.is_on_boundary(index))
+		{
+			_new_coarse_temp[index] = _boundary_temp + SUBCYCLES * boundary_increment;
+		}
+		else
+		{
+			_new_coarse_temp[index] = point_temp
+				+ _property_table.thermal_diffusivity(point_temp) * coarse_dt * _coarse_temp.laplacian(index)
+				+ coarse_dt * chem_heat;
+		}
+	}
+
+	// fine timesteps over the refined blocks, adding up the heat carried into them across the surface of the
+	// refined region
+	double const inverse_h2[3] = { 1 / (_fine_spacing[0] * _fine_spacing[0]),
+		1 / (_fine_spacing[1] * _fine_spacing[1]), 1 / (_fine_spacing[2] * _fine_spacing[2]) };
+	size_t const interface_points = _interface_points.size();
+	std::fill(_interface_heat.begin(), _interface_heat.end(), 0.0);
+	bool fine_non_finite = false;
+	for (size_t substep = 0; substep < SUBCYCLES; substep++)
+	{
+		double const theta = static_cast<double>(substep) / SUBCYCLES;
+		double const boundary_temp = _boundary_temp + (substep + 1) * boundary_increment;
+
+#pragma omp parallel for schedule(dynamic)
+		for (size_t b = 0; b < blocks; b++)
+		{
+			if (_fine_blocks[b].refined)
+			{
+				fill_halo(b, theta);
+			}
+		}
+
+#pragma omp parallel for schedule(dynamic, 64)
+		for (size_t n = 0; n < interface_points; n++)
+		{
+			double heat = 0.0;
+			for (size_t i = _interface_starts[n]; i < _interface_starts[n + 1]; i++)
+			{
+				InterfaceFlux const& flux = _interface_fluxes[i];
+				std::vector<double> const& fine_temp = _fine_blocks[flux.block].temp;
+				heat += flux.weight * _property_table.thermal_diffusivity(fine_temp[flux.local])
+					* (fine_temp[flux.neighbour] - fine_temp[flux.local]) * inverse_h2[flux.axis];
+			}
+			_interface_heat[n] += dt * heat;
+		}
+
+#pragma omp parallel for schedule(dynamic) reduction(||:fine_non_finite)
+		for (size_t b = 0; b < blocks; b++)
+		{
+			if (_fine_blocks[b].refined)
+			{
+				fine_non_finite = update_block(b, dt, (substep + 1.0) / SUBCYCLES, boundary_temp) or fine_non_finite;
+				_fine_blocks[b].temp.swap(_fine_blocks[b].new_temp);
+			}
+		}
+	}
+
+	// reflux: the coarse points on the surface of the refined region give up the heat the fine timesteps took
+	// across it (each coarse control volume holds eight fine ones) in place of their coarse fluxes into the region
+	size_t const stride[3] = { _coarse_size[1] * _coarse_size[2], _coarse_size[2], 1 };
+	double const inverse_coarse_h2[3] = { inverse_h2[0] / 4, inverse_h2[1] / 4, inverse_h2[2] / 4 };
+#pragma omp parallel for
+	for (size_t n = 0; n < interface_points; n++)
+	{
+		size_t const index = _interface_points[n];
+		double const point_temp = _coarse_temp[index];
+		double covered_laplacian = 0.0;
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			for (size_t const neighbour : { index - stride[axis], index + stride[axis] })
+			{
+				if (_covered[neighbour])
+				{
+					covered_laplacian += (_coarse_temp[neighbour] - point_temp) * inverse_coarse_h2[axis];
+				}
+			}
+		}
+		_new_coarse_temp[index] -= _property_table.thermal_diffusivity(point_temp) * coarse_dt * covered_laplacian
+			+ _interface_heat[n] / 8;
+	}
+
+	// coarse points inside the refined region take the volume-weighted average of the fine points
+	size_t const covered_points = _covered_points.size();
+#pragma omp parallel for
+	for (size_t n = 0; n < covered_points; n++)
+	{
+		restrict_to_coarse(_covered_points[n]);
+	}
+
+	// residual norms over the coarse mesh
+	PointReductions const coarse = reduce_over_points(coarse_size, _coarse_conf_file_data._deterministic_reductions, 0,
+		[&](size_t const index, PointReductions& reductions)
+	{
+		double const change = _new_coarse_temp[index] - _coarse_temp[index];
+		reductions.max_change = std::max(reductions.max_change, std::abs(change));
+		reductions.sum_of_square_changes += change * change;
+		reductions.non_finite = reductions.non_finite or not std::isfinite(_new_coarse_temp[index]);
+	});
+
+	// (every coarse point of _new_coarse_temp is written again at the start of the next timestep)
+	_coarse_temp.swap_values(_new_coarse_temp);
+	_boundary_temp += SUBCYCLES * boundary_increment;
+
+	// the fine points on the surface of the refined region follow the refluxed coarse points
+#pragma omp parallel for schedule(dynamic)
+	for (size_t b = 0; b < blocks; b++)
+	{
+		if (_fine_blocks[b].refined)
+		{
+			fill_interface(b);
+		}
+	}
+
+	sum_of_square_changes += coarse.sum_of_square_changes;
+	non_finite = non_finite or coarse.non_finite or fine_non_finite;
+	return coarse.max_change;
+}
+
+/*
+Regridding
+A block is flagged if the temperature jumps by more than amr_refine_temp_jump between neighbouring coarse points
+in it, or if k * c for any species exceeds amr_refine_chem_rate at any of its coarse points. Flagged blocks and
+their neighbours are refined, so that a front can't leave the refined region before the next regrid; all other
+blocks are coarsened.
+*/
+
+size_t AMRCuboid::regrid()
+{
+	size_t const blocks = _fine_blocks.size();
+	std::vector<char> flagged(blocks, 0);
+
+#pragma omp parallel for schedule(dynamic)
+	for (size_t b = 0; b < blocks; b++)
+	{
+		size_t const bc[3] = { b / (_blocks[1] * _blocks[2]), (b / _blocks[2]) % _blocks[1], b % _blocks[2] };
+		size_t const stride[3] = { _coarse_size[1] * _coarse_size[2], _coarse_size[2], 1 };
+
+		for (size_t i = bc[0] * _block_size; i <= (bc[0] + 1) * _block_size and not flagged[b]; i++)
+		{
+			for (size_t j = bc[1] * _block_size; j <= (bc[1] + 1) * _block_size and not flagged[b]; j++)
+			{
+				for (size_t k = bc[2] * _block_size; k <= (bc[2] + 1) * _block_size and not flagged[b]; k++)
+				{
+					size_t const c[3] = { i, j, k };
+					size_t const index = coarse_index(i, j, k);
+					double const point_temp = _coarse_temp[index];
+
+					for (size_t axis = 0; axis < 3; axis++)
+					{
+						if (c[axis] < (bc[axis] + 1) * _block_size
+							and std::abs(_coarse_temp[index + stride[axis]] - point_temp) > _refine_temp_jump)
+						{
+							flagged[b] = 1;
+						}
+					}
+					for (size_t species = 0; species < _coarse_chem.size(); species++)
+					{
+						if (_chem_species_array[species].k(point_temp) * _coarse_chem[species][index] > _refine_chem_rate)
+						{
+							flagged[b] = 1;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// refine flagged blocks and their neighbours, coarsen the rest
+	std::vector<char> refine(blocks, 0);
+	for (size_t b = 0; b < blocks; b++)
+	{
+		if (not flagged[b])
+		{
+			continue;
+		}
+		size_t const bc[3] = { b / (_blocks[1] * _blocks[2]), (b / _blocks[2]) % _blocks[1], b % _blocks[2] };
+		for (size_t i = (bc[0] > 0 ? bc[0] - 1 : 0); i <= std::min(bc[0] + 1, _blocks[0] - 1); i++)
+		{
+			for (size_t j = (bc[1] > 0 ? bc[1] - 1 : 0); j <= std::min(bc[1] + 1, _blocks[1] - 1); j++)
+			{
+				for (size_t k = (bc[2] > 0 ? bc[2] - 1 : 0); k <= std::min(bc[2] + 1, _blocks[2] - 1); k++)
+				{
+					refine[block_index(i, j, k)] = 1;
+				}
+			}
+		}
+	}
+
+	size_t refined_blocks = 0;
+	for (size_t b = 0; b < blocks; b++)
+	{
+		if (refine[b] and not _fine_blocks[b].refined)
+		{
+			refine_block(b);
+		}
+		else if (not refine[b] and _fine_blocks[b].refined)
+		{
+			coarsen_block(b);
+		}
+		refined_blocks += refine[b];
+	}
+
+	// points inside the refined region before may now be on its surface
+	find_interface();
+#pragma omp parallel for schedule(dynamic)
+	for (size_t b = 0; b < blocks; b++)
+	{
+		if (_fine_blocks[b].refined)
+		{
+			fill_interface(b);
+		}
+	}
+	return refined_blocks;
+}
+
+/*
+Output
+*/
+
+void AMRCuboid::set_temperature(std::function<double(double, double, double)> const& temperature)
+{
+	for (size_t index = 0; index < _coarse_temp.size(); index++)
+	{
+		size_t const g[3] = { 2 * (index / (_coarse_size[1] * _coarse_size[2])),
+			2 * ((index / _coarse_size[2]) % _coarse_size[1]), 2 * (index % _coarse_size[2]) };
+		_coarse_temp[index] = temperature(g[0] * _fine_spacing[0], g[1] * _fine_spacing[1], g[2] * _fine_spacing[2]);
+	}
+	for (size_t b = 0; b < _fine_blocks.size(); b++)
+	{
+		FineBlock& block = _fine_blocks[b];
+		if (not block.refined)
+		{
+			continue;
+		}
+		size_t const bc[3] = { b / (_blocks[1] * _blocks[2]), (b / _blocks[2]) % _blocks[1], b % _blocks[2] };
+		for (size_t sx = 1; sx <= owned_end(0, bc[0]); sx++)
+		{
+			for (size_t sy = 1; sy <= owned_end(1, bc[1]); sy++)
+			{
+				for (size_t sz = 1; sz <= owned_end(2, bc[2]); sz++)
+				{
+					size_t const g[3] = { bc[0] * _block_span + sx - 1, bc[1] * _block_span + sy - 1,
+						bc[2] * _block_span + sz - 1 };
+					block.temp[local_index(sx, sy, sz)] = temperature(g[0] * _fine_spacing[0],
+						g[1] * _fine_spacing[1], g[2] * _fine_spacing[2]);
+				}
+			}
+		}
+		fill_interface(b);
+	}
+}
+
+double AMRCuboid::heat_added() const
+{
+	double const fine_volume = _fine_spacing[0] * _fine_spacing[1] * _fine_spacing[2];
+	double integral = 0.0;
+	for (size_t index = 0; index < _coarse_temp.size(); index++)
+	{
+		if (not _coarse_temp.is_on_boundary(index) and not _covered[index])
+		{
+			integral += 8 * fine_volume * (_coarse_temp[index] - _initial_temp);
+		}
+	}
+	for (size_t b = 0; b < _fine_blocks.size(); b++)
+	{
+		FineBlock const& block = _fine_blocks[b];
+		if (not block.refined)
+		{
+			continue;
+		}
+		size_t const bc[3] = { b / (_blocks[1] * _blocks[2]), (b / _blocks[2]) % _blocks[1], b % _blocks[2] };
+		for (size_t sx = 1; sx <= owned_end(0, bc[0]); sx++)
+		{
+			for (size_t sy = 1; sy <= owned_end(1, bc[1]); sy++)
+			{
+				for (size_t sz = 1; sz <= owned_end(2, bc[2]); sz++)
+				{
+					size_t const g[3] = { bc[0] * _block_span + sx - 1, bc[1] * _block_span + sy - 1,
+						bc[2] * _block_span + sz - 1 };
+					if (not on_faces(g) and refined_interior(g))
+					{
+						integral += fine_volume * (block.temp[local_index(sx, sy, sz)] - _initial_temp);
+					}
+				}
+			}
+		}
+	}
+	return integral;
+}
+
+void AMRCuboid::resample(Mesh& temp, std::vector<CuboidMesh>& chem) const
+{
+#pragma omp parallel for
+	for (size_t i = 0; i < _fine_size[0]; i++)
+	{
+		for (size_t j = 0; j < _fine_size[1]; j++)
+		{
+			for (size_t k = 0; k < _fine_size[2]; k++)
+			{
+				size_t const g[3] = { i, j, k };
+				size_t const b[3] = { owner(0, i), owner(1, j), owner(2, k) };
+				FineBlock const& block = _fine_blocks[block_index(b[0], b[1], b[2])];
+				size_t const index = (i * _fine_size[1] + j) * _fine_size[2] + k;
+
+				if (block.refined)
+				{
+					size_t const local = local_index(i - b[0] * _block_span + 1, j - b[1] * _block_span + 1,
+						k - b[2] * _block_span + 1);
+					temp[index] = block.temp[local];
+					for (size_t species = 0; species < chem.size(); species++)
+					{
+						chem[species][index] = block.chem[species][local];
+					}
+				}
+				else
+				{
+					temp[index] = coarse_interpolate(_coarse_temp, g);
+					for (size_t species = 0; species < chem.size(); species++)
+					{
+						chem[species][index] = coarse_interpolate(_coarse_chem[species], g);
+					}
+				}
+			}
+		}
+	}
+}
+void AMRCuboid::copy_coarse(Mesh& temp, std::vector<CuboidMesh>& chem) const
+{
+	for (size_t index = 0; index < _coarse_temp.size(); index++)
+	{
+		temp[index] = _coarse_temp[index];
+		for (size_t species = 0; species < chem.size(); species++)
+		{
+			chem[species][index] = _coarse_chem[species][index];
+		}
+	}
+}
+
+/*
+Driver
+The time loop follows heateqn_solver, with each step a coarse timestep; diverging runs stop with an error rather
+than being rolled back.
+*/
+
+void amr_cuboid_solver(ConfFileData& cf, CSVFileData& csv_file_data, std::ofstream& log_file)
+{
+	// refinement and the coarse chemistry assume independent species
+	if (cf._chemistry_on and csv_file_data._network)
+	{
+		Log::error_write(log_file, "amr_on=true can't be used with a reaction network chemistry file.\n");
+	}
+
+	// property tables and the adaptive mesh
+	PropertyTable const& property_table = property_table_for(cf, log_file);
+	AMRCuboid amr(cf, csv_file_data, property_table);
+	std::vector<ChemSpecies> chem_species_array = csv_file_data._chem_array;
+
+	// output meshes, either the uniform mesh of settings.conf or the coarse mesh
+	ConfFileData& output_cf = cf._amr_output_uniform ? cf : amr.coarse_conf_file_data();
+	CuboidMesh temp(output_cf, "output_temp");
+	CuboidMesh heat_capacity(temp, "specific_heat_capacity");
+	CuboidMesh thermal_conductivity(temp, "thermal_conductivity");
+	std::vector<CuboidMesh> chem_meshes;
+	if (cf._chemistry_on)
+	{
+		for (size_t species = 0; species < csv_file_data.number_of_species(); species++)
+		{
+			chem_meshes.push_back(CuboidMesh(temp, "output_chem" + std::to_string(species + 1)));
+		}
+	}
+	Log::write(log_file, "Mesh initiailisations successful. Adaptive mesh has " + std::to_string(amr.number_of_blocks())
+		+ " blocks.\n");
+
+	// copy the solution onto the output meshes and write them out
+	auto write_output = [&](size_t const second_count)
+	{
+		if (cf._amr_output_uniform)
+		{
+			amr.resample(temp, chem_meshes);
+		}
+		else
+		{
+			amr.copy_coarse(temp, chem_meshes);
+		}
+
+		temp.write_files(second_count, cf._significant_digits);
+		if (not cf._fixed_specific_heat_capacity)
+		{
+			for (size_t i = 0; i < temp.size(); i++)
+			{
+				heat_capacity[i] = property_table.heat_capacity(temp[i]);
+			}
+			heat_capacity.write_files(second_count, cf._significant_digits);
+		}
+		if (not cf._fixed_thermal_conductivity)
+		{
+			for (size_t i = 0; i < temp.size(); i++)
+			{
+				thermal_conductivity[i] = property_table.thermal_conductivity(temp[i]);
+			}
+			thermal_conductivity.write_files(second_count, cf._significant_digits);
+		}
+		for (auto& chem_mesh : chem_meshes)
+		{
+			chem_mesh.write_files(second_count, cf._significant_digits);
+		}
+	};
+
+	temp.setup_files();
+	if (not cf._fixed_specific_heat_capacity)
+	{
+		heat_capacity.setup_files();
+	}
+	if (not cf._fixed_thermal_conductivity)
+	{
+		thermal_conductivity.setup_files();
+	}
+	for (auto& chem_mesh : chem_meshes)
+	{
+		chem_mesh.setup_files();
+	}
+	write_output(0);
+	Log::write(log_file, "Mesh files created and written to successfully.\n");
+
+	/*
+	Set up for time loop
+	*/
+	auto clock_start = std::chrono::steady_clock::now();
+
+	// the stability limit is set by the coarse mesh, with refined blocks taking SUBCYCLES timesteps per coarse timestep
+	ConfFileData& coarse_cf = amr.coarse_conf_file_data();
+	coarse_cf._timesteps_per_second = (cf._timesteps_per_second + AMRCuboid::SUBCYCLES - 1) / AMRCuboid::SUBCYCLES;
+	plan_timesteps_per_second(coarse_cf, chem_species_array, property_table, amr.coarse_temp(), log_file);
+	size_t const coarse_steps_per_second = coarse_cf._timesteps_per_second;
+	cf._timesteps_per_second = coarse_steps_per_second * AMRCuboid::SUBCYCLES;
+	Log::write(log_file, "Coarse mesh takes " + std::to_string(coarse_steps_per_second)
+		+ " timesteps per second and refined blocks take " + std::to_string(cf._timesteps_per_second) + ".\n");
+
+	double const dt = 1.0 / cf._timesteps_per_second;
+	double const coarse_dt = AMRCuboid::SUBCYCLES * dt;
+	size_t heating_steps_remaining = (cf.heating_timesteps() + AMRCuboid::SUBCYCLES - 1) / AMRCuboid::SUBCYCLES;
+	size_t const coarse_mesh_size = amr.coarse_mesh_size();
+	size_t current_model_time_secs = 0;
+	size_t coarse_steps = 0;
+	size_t refined_blocks = amr.regrid();
+	bool cooling_started = false;
+	bool equilibrium_reached = false;
+
+	/*
+	Time loop
+	*/
+	Log::write(log_file, "Beginning heating loop.\n");
+	while (heating_steps_remaining > 0 or (cf._cooling_phase and not equilibrium_reached))
+	{
+		bool second_completed = true;
+		for (size_t step = 1; step <= coarse_steps_per_second; step++)
+		{
+			bool const heating = (heating_steps_remaining > 0);
+			if (not heating and not cf._cooling_phase)
+			{
+				second_completed = false;
+				break;
+			}
+			if (not heating and not cooling_started)
+			{
+				Log::write(log_file, "Beginning cooling loop.\n");
+				cooling_started = true;
+			}
+
+			double const boundary_increment = heating ? (cf._heating_rate / 60) * dt : 0.0;
+			double sum_of_square_changes = 0.0;
+			bool non_finite = false;
+			double const max_change = amr.step(dt, boundary_increment, sum_of_square_changes, non_finite);
+			coarse_steps++;
+
+			if (non_finite)
+			{
+				Log::error_write(log_file, "Temperature field has diverged during second "
+					+ std::to_string(current_model_time_secs + 1) + ". Try increasing timesteps_per_second.\n");
+			}
+
+			if (heating)
+			{
+				heating_steps_remaining--;
+			}
+			else if (not equilibrium_reached)
+			{
+				// (a run that reaches equilibrium part way through a second finishes it, so that the field written
+				// out is the state at its end)
+				double const max_rate = max_change / coarse_dt;
+				double const rms_rate = std::sqrt(sum_of_square_changes / coarse_mesh_size) / coarse_dt;
+				equilibrium_reached = (max_rate < cf._equilibrium_max_rate) and (rms_rate < cf._equilibrium_rms_rate);
+				if (equilibrium_reached)
+				{
+					Log::write(log_file, "Equilibrium reached after "
+						+ std::to_string(current_model_time_secs + step * coarse_dt)
+						+ " seconds of simulated time.\n");
+				}
+			}
+
+			if (coarse_steps % cf._amr_regrid_steps == 0)
+			{
+				refined_blocks = amr.regrid();
+			}
+		}
+
+		if (not second_completed)
+		{
+			break;
+		}
+
+		current_model_time_secs++;
+		write_output(current_model_time_secs);
+
+		// write progress update to stdout
+		auto clock_tick = std::chrono::steady_clock::now();
+		std::chrono::duration<double> elapsed_seconds = clock_tick - clock_start;
+		Log::write_to_console(std::to_string(current_model_time_secs)
+			+ " seconds elapsed in simulation. "
+			+ std::to_string(refined_blocks) + " of " + std::to_string(amr.number_of_blocks())
+			+ " blocks refined. "
+			+ "Time taken so far: "
+			+ std::to_string(elapsed_seconds.count())
+			+ " seconds.\n");
+	}
+
+	// simulation completed
+	auto clock_tick = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed_seconds = clock_tick - clock_start;
+	Log::write(log_file, "Simulation completed. Time elapsed: " + std::to_string(elapsed_seconds.count()) + " seconds.\n");
+}
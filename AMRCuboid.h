@@ -0,0 +1,159 @@
+#pragma once
+#include <vector>
+#include <fstream>
+#include <functional>
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+#include "ChemSpecies.h"
+#include "Mesh.h"
+#include "PropertyTable.h"
+
+/*
+Block-structured adaptive mesh refinement for the cuboid.
+
+The cuboid is covered by a coarse mesh with twice the spacing of the mesh in settings.conf, split into cubic
+blocks of amr_block_size coarse intervals per side. Blocks where the temperature jumps sharply between
+neighbouring coarse points, or where chemistry is running quickly (k times the remaining fraction), are refined
+to the full resolution in settings.conf. Every coarse timestep is followed by four fine timesteps on the refined
+blocks (the explicit stability limit goes as the spacing squared).
+
+The coarse points on the surface of the refined region belong to the coarse mesh, and the fine points on that
+surface are interpolated from them in space and time. The heat the fine timesteps carry across the surface is
+taken from the coarse points it was interpolated from (refluxing), in place of their own coarse fluxes into the
+refined region, so no heat is gained or lost between the levels. The coarse points inside the refined region
+are then set to the volume-weighted average of the fine points around them.
+*/
+
+// A block of the fine mesh, stored with one layer of halo points on each side
+struct FineBlock
+{
+	bool refined = false;
+	std::vector<double> temp;
+	std::vector<double> new_temp;
+	std::vector<std::vector<double>> chem;
+};
+
+// The flux into a fine point from its neighbour on the surface of the refined region along axis, which is
+// taken from a coarse point on the surface with the weight that point has in the neighbour's interpolation
+struct InterfaceFlux
+{
+	size_t block;
+	size_t local;
+	size_t neighbour;
+	size_t axis;
+	double weight;
+};
+
+class AMRCuboid
+{
+private:
+	// Settings
+	PropertyTable const& _property_table;
+	std::vector<ChemSpecies> _chem_species_array;
+	std::vector<double> _species_heat;
+	ChemKinetics _kinetics;
+	bool _chemistry_on;
+	double _refine_temp_jump;
+	double _refine_chem_rate;
+
+	// Fine mesh: number of points and spacing (in metres) along each axis
+	size_t _fine_size[3];
+	double _fine_spacing[3];
+
+	// Coarse mesh
+	ConfFileData _coarse_conf_file_data;
+	size_t _coarse_size[3];
+	CuboidMesh _coarse_temp;
+	CuboidMesh _new_coarse_temp;
+	std::vector<CuboidMesh> _coarse_chem;
+
+	// Blocks: coarse intervals and fine intervals per side, number of blocks along each axis,
+	// and points per side of a block's arrays (including the halo)
+	size_t _block_size;
+	size_t _block_span;
+	size_t _blocks[3];
+	size_t _local_size;
+	std::vector<FineBlock> _fine_blocks;
+
+	// Coarse points inside the refined region, and coarse points on its surface with the fine fluxes taken from
+	// each (those of _interface_points[n] run from _interface_starts[n] to _interface_starts[n + 1]) and the heat
+	// they have carried over the current coarse timestep (in Kelvin on the fine points)
+	std::vector<char> _covered;
+	std::vector<size_t> _covered_points;
+	std::vector<size_t> _interface_points;
+	std::vector<size_t> _interface_starts;
+	std::vector<InterfaceFlux> _interface_fluxes;
+	std::vector<double> _interface_heat;
+
+	// Initial temperature and current temperature of the boundary
+	double _initial_temp;
+	double _boundary_temp;
+
+	// Index helpers
+	size_t block_index(size_t const bx, size_t const by, size_t const bz) const;
+	size_t local_index(size_t const sx, size_t const sy, size_t const sz) const;
+	size_t coarse_index(size_t const i, size_t const j, size_t const k) const;
+	size_t owned_end(size_t const axis, size_t const b) const;
+	size_t owner(size_t const axis, size_t const g) const;
+	size_t fine_location(size_t const g[3], size_t& local) const;
+
+	// Fine points on the faces of the cuboid, inside the refined region (every block touching them is refined),
+	// and on the surface of the refined region
+	bool on_faces(size_t const g[3]) const;
+	size_t blocks_around(size_t const g[3], size_t& refined) const;
+	bool refined_interior(size_t const g[3]) const;
+	bool on_interface(size_t const g[3]) const;
+	void find_interface();
+
+	// Transfers between levels
+	double coarse_interpolate(Mesh const& coarse, size_t const g[3]) const;
+	double fine_value(size_t const g[3]) const;
+	void fill_halo(size_t const b, double const theta);
+	void fill_interface(size_t const b);
+	void restrict_to_coarse(size_t const index);
+	void refine_block(size_t const b);
+	void coarsen_block(size_t const b);
+
+	// Chemistry at point index over a timestep: updates the remaining fractions in chem and returns the
+	// rate of heating from the reactions
+	template <typename F>
+	double react(double const temp, F& chem, size_t const index, double const dt) const;
+
+	// Advance the points of a refined block by one fine timestep, ending at time fraction theta through the
+	// coarse timestep
+	bool update_block(size_t const b, double const dt, double const theta, double const boundary_temp);
+
+public:
+	AMRCuboid(ConfFileData& conf_file_data, CSVFileData& csv_file_data, PropertyTable const& property_table);
+
+	// Advance by one coarse timestep (SUBCYCLES fine timesteps of length dt), raising the boundary temperature
+	// by boundary_increment every fine timestep. Returns the largest change in temperature on the coarse mesh
+	// and accumulates the sum of squared changes, and whether any value was non-finite.
+	double step(double const dt, double const boundary_increment, double& sum_of_square_changes, bool& non_finite);
+
+	// Refine and coarsen blocks using the current solution; returns the number of refined blocks
+	size_t regrid();
+	size_t number_of_blocks() const;
+	size_t coarse_mesh_size() const;
+
+	// Copy the solution onto output meshes, either the uniform mesh of settings.conf or the coarse mesh
+	void resample(Mesh& temp, std::vector<CuboidMesh>& chem) const;
+	void copy_coarse(Mesh& temp, std::vector<CuboidMesh>& chem) const;
+	ConfFileData& coarse_conf_file_data();
+	CuboidMesh const& coarse_temp() const;
+
+	// Set the temperature (in Kelvin) at every point from a function of position (in metres)
+	void set_temperature(std::function<double(double, double, double)> const& temperature);
+
+	// Integral of the rise in temperature above the initial temperature over the cuboid (in Kelvin cubic metres),
+	// from the fine points inside the refined region and the coarse points elsewhere. With fixed properties and no
+	// chemistry this is the heat added over the volumetric heat capacity, which only changes by the flow of heat
+	// through the faces of the cuboid.
+	double heat_added() const;
+
+	// Ratio of coarse to fine timesteps
+	static size_t const SUBCYCLES = 4;
+};
+
+// Solve the cuboid problem with adaptive mesh refinement (amr_on=true in settings.conf)
+void amr_cuboid_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file);
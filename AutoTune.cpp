@@ -0,0 +1,170 @@
+#include "AutoTune.h"
+#include "Log.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// jobs of the server (see Server.h) can share a cache
+static std::mutex cache_mutex;
+
+std::string ExecutionPlan::description() const
+{
+	std::string description = std::to_string(threads) + ((threads == 1) ? " thread" : " threads");
+	if (threads > 1)
+	{
+		description += (chunk_size > 0) ? ", in chunks of " + std::to_string(chunk_size) + " points"
+			: ", sharing the points out equally";
+	}
+	return description;
+}
+
+void apply_execution_plan([[maybe_unused]] ExecutionPlan const& plan)
+{
+#ifdef _OPENMP
+	omp_set_num_threads(static_cast<int>(plan.threads));
+#endif
+}
+
+std::vector<ExecutionPlan> candidate_plans(size_t const points, bool const deterministic)
+{
+	size_t max_threads = 1;
+#ifdef _OPENMP
+	max_threads = static_cast<size_t>(omp_get_max_threads());
+#endif
+
+	// 1, 2, 4, ... threads and all of them
+	std::vector<size_t> thread_counts;
+	for (size_t threads = 1; threads < max_threads; threads *= 2)
+	{
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(max_threads);
+
+	// chunks are only worth trying if each thread gets several of them
+	size_t const chunk_sizes[] = { 64, 1024 };
+	std::vector<ExecutionPlan> plans;
+	for (size_t const threads : thread_counts)
+	{
+		plans.push_back({ threads, 0 });
+		for (size_t const chunk_size : chunk_sizes)
+		{
+			if (threads > 1 and not deterministic and 4 * chunk_size * threads <= points)
+			{
+				plans.push_back({ threads, chunk_size });
+			}
+		}
+	}
+	return plans;
+}
+
+ExecutionPlan fastest_plan(std::vector<ExecutionPlan> const& candidates, size_t const timesteps,
+	std::function<void(ExecutionPlan const& plan)> const& timestep, std::ofstream& log_file)
+{
+	ExecutionPlan fastest = candidates.front();
+	double fastest_seconds = INFINITY;
+	for (auto const& plan : candidates)
+	{
+		apply_execution_plan(plan);
+		timestep(plan);
+		auto const start = std::chrono::steady_clock::now();
+		for (size_t step = 0; step < timesteps; step++)
+		{
+			timestep(plan);
+		}
+		std::chrono::duration<double> const seconds = std::chrono::steady_clock::now() - start;
+
+		std::ostringstream message;
+		message << "  " << plan.description() << ": " << std::setprecision(3) << 1e6 * seconds.count() / timesteps
+			<< " microseconds per timestep\n";
+		Log::write_to_log_file(log_file, message.str());
+		if (seconds.count() < fastest_seconds)
+		{
+			fastest = plan;
+			fastest_seconds = seconds.count();
+		}
+	}
+	return fastest;
+}
+
+// Name of the CPU, as far as it can be found
+static std::string cpu_name()
+{
+	std::ifstream cpuinfo("/proc/cpuinfo");
+	std::string line;
+	while (std::getline(cpuinfo, line))
+	{
+		if (line.rfind("model name", 0) == 0 and line.find(':') != std::string::npos)
+		{
+			return line.substr(line.find_first_not_of(" \t", line.find(':') + 1));
+		}
+	}
+	return "unknown CPU";
+}
+
+std::string tuning_key(ConfFileData const& conf_file_data, size_t const points, size_t const number_of_species)
+{
+	size_t max_threads = 1;
+#ifdef _OPENMP
+	max_threads = static_cast<size_t>(omp_get_max_threads());
+#endif
+	// (everything that picks a different kernel, or changes the work of each point, gets its own plan)
+	return "geometry=" + std::to_string(conf_file_data._geometry) + " points=" + std::to_string(points)
+		+ " time_integration=" + conf_file_data._time_integration
+		+ " chemistry_on=" + std::to_string(conf_file_data._chemistry_on)
+		+ " species=" + std::to_string(number_of_species)
+		+ " spatial_order=" + std::to_string(conf_file_data._spatial_order)
+		+ " symmetry_reduction=" + std::to_string(conf_file_data._symmetry_reduction)
+		+ " mixed_precision=" + std::to_string(conf_file_data._mixed_precision)
+		+ " threads=" + std::to_string(max_threads) + " cpu=" + cpu_name();
+}
+
+// Each line of the cache is a key, the number of threads and the chunk size, separated by tabs
+
+bool read_cached_plan(std::string const& path, std::string const& key, ExecutionPlan& plan)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	std::ifstream cache(path);
+	std::string line;
+	while (std::getline(cache, line))
+	{
+		std::stringstream fields(line);
+		std::string line_key;
+		ExecutionPlan line_plan;
+		if (std::getline(fields, line_key, '\t') and line_key == key
+			and fields >> line_plan.threads >> line_plan.chunk_size and line_plan.threads > 0)
+		{
+			plan = line_plan;
+			return true;
+		}
+	}
+	return false;
+}
+
+void write_cached_plan(std::string const& path, std::string const& key, ExecutionPlan const& plan)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	std::vector<std::string> lines;
+	std::ifstream old_cache(path);
+	std::string line;
+	while (std::getline(old_cache, line))
+	{
+		if (line.substr(0, line.find('\t')) != key)
+		{
+			lines.push_back(line);
+		}
+	}
+	old_cache.close();
+	lines.push_back(key + '\t' + std::to_string(plan.threads) + '\t' + std::to_string(plan.chunk_size));
+
+	std::ofstream cache(path);
+	for (auto const& cache_line : lines)
+	{
+		cache << cache_line << '\n';
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ConfFileData.h"
+
+/*
+Auto-tuning of the parallel execution of the solver (auto_tune=true in settings.conf).
+
+Which way of running the update loops (see Reductions.h) is fastest depends on the problem: a small sphere runs
+fastest on one thread, as sharing out a few points costs more than updating them, while a large cuboid wants every
+thread, and points whose cost varies (with the chemistry only running at hot points) may be better handed out in
+chunks as the threads finish than shared out equally beforehand. Before the heating loop the solver times
+tuning_timesteps timesteps from the initial state with each of the candidate plans below and keeps the fastest
+(running the chemistry at every point, as it would be once the particle is hot, rather than skipping it at the
+cold starting temperature). The choice is saved in tuning_cache, keyed by the problem, the settings that choose
+its kernels and the CPU, so later runs of the same problem skip the timing. Only ways of running that give the same results are tried: the precision of the fields and the kernels
+compiled for the settings (see heateqn_solver.cpp) are left as set in settings.conf.
+*/
+
+// A way of running the update loops
+struct ExecutionPlan
+{
+	// number of OpenMP threads
+	size_t threads = 1;
+	// points handed out to the threads at a time as they finish (0 to share them out equally beforehand)
+	size_t chunk_size = 0;
+
+	std::string description() const;
+};
+
+// Run the OpenMP loops of the calling thread on the threads of plan (the chunk size is passed to the update loops)
+void apply_execution_plan(ExecutionPlan const& plan);
+
+// Plans worth timing for a mesh of points points, on up to the current OpenMP thread count (with
+// deterministic_reductions=true the points are summed in fixed blocks, so only the thread count is tuned)
+std::vector<ExecutionPlan> candidate_plans(size_t const points, bool const deterministic);
+
+// Time timesteps calls of timestep(plan) (after one more to start the threads) with each plan in turn applied,
+// logging the times, and return the fastest plan
+ExecutionPlan fastest_plan(std::vector<ExecutionPlan> const& candidates, size_t const timesteps,
+	std::function<void(ExecutionPlan const& plan)> const& timestep, std::ofstream& log_file);
+
+// Key of the cache of plans, identifying the problem (from its settings and number of points) and the CPU
+std::string tuning_key(ConfFileData const& conf_file_data, size_t const points, size_t const number_of_species);
+
+// Look up the plan saved for key in the cache at path, returning whether there was one
+bool read_cached_plan(std::string const& path, std::string const& key, ExecutionPlan& plan);
+// Save plan for key in the cache at path, replacing any plan saved for it before
+void write_cached_plan(std::string const& path, std::string const& key, ExecutionPlan const& plan);
@@ -4,6 +4,32 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <cmath>
+
+/*
+Distributed activation energy model
+A row with an Ea spread s (in kcal) and a number of components n stands for a Gaussian distribution of Ea with
+mean Ea and standard deviation s, over Ea - 3s to Ea + 3s. It becomes n species sharing the row's A, dH and molar
+mass, with equally spaced Ea and the row's proportion split between them in proportion to the Gaussian density.
+*/
+static void add_gaussian_components(std::vector<ChemSpecies>& chem_array, double const A, double const Ea,
+	double const proportion, double const dH, double const molar_mass, double const Ea_spread, size_t const components)
+{
+	double const width = 6 * Ea_spread;
+	std::vector<double> weights(components);
+	double weight_sum = 0.0;
+	for (size_t j = 0; j < components; j++)
+	{
+		double const x = (j * width / (components - 1) - width / 2) / Ea_spread;
+		weights[j] = std::exp(-x * x / 2);
+		weight_sum += weights[j];
+	}
+	for (size_t j = 0; j < components; j++)
+	{
+		double const component_Ea = Ea - width / 2 + j * width / (components - 1);
+		chem_array.push_back(ChemSpecies(A, component_Ea * 4184, proportion * weights[j] / weight_sum, dH, molar_mass));
+	}
+}
 
 CSVFileData::CSVFileData(std::string path)
 {
@@ -17,8 +43,16 @@ CSVFileData::CSVFileData(std::string path)
 	// species_list is the output vector of ChemSpecies objects.
 	std::string line;
 
-	// Read the first line and ignore it (just labels)
+	// Read the first line and ignore it (just labels), unless the file is a reaction network
 	std::getline(csv_file, line);
+	if (line.rfind("species", 0) == 0 or line.rfind("reaction", 0) == 0 or line.rfind("#", 0) == 0)
+	{
+		csv_file.clear();
+		csv_file.seekg(0);
+		_network = std::make_shared<ReactionNetwork const>(csv_file);
+		_chem_array = _network->reactions();
+		return;
+	}
 	line.clear();
 
 	double file_A{ 0.0 };
@@ -49,8 +83,26 @@ CSVFileData::CSVFileData(std::string path)
 		std::getline(linestream, str_double, ',');
 		file_molar_mass = stod(str_double);
 
-		this->_chem_array.push_back(ChemSpecies(file_A, file_Ea * 4184, file_proportion,
-			file_dH, file_molar_mass));
+		// optional columns for a distributed activation energy model
+		double file_Ea_spread{ 0.0 };
+		size_t file_components{ 1 };
+		if (std::getline(linestream, str_double, ',') and str_double.find_first_not_of(" \r") != std::string::npos)
+		{
+			file_Ea_spread = stod(str_double);
+			std::getline(linestream, str_double, ',');
+			file_components = stoul(str_double);
+		}
+
+		if (file_Ea_spread > 0 and file_components > 1)
+		{
+			add_gaussian_components(this->_chem_array, file_A, file_Ea, file_proportion, file_dH, file_molar_mass,
+				file_Ea_spread, file_components);
+		}
+		else
+		{
+			this->_chem_array.push_back(ChemSpecies(file_A, file_Ea * 4184, file_proportion,
+				file_dH, file_molar_mass));
+		}
 	}
 
 	// Check proportions sum to 100.0 (or, at least, are close!)
@@ -67,7 +119,12 @@ CSVFileData::CSVFileData(std::string path)
 	csv_file.close();
 }
 
+CSVFileData::CSVFileData(std::vector<ChemSpecies> const& chem_array)
+	: _chem_array(chem_array)
+{
+}
+
 size_t CSVFileData::number_of_species()
 {
-	return _chem_array.size();
+	return _network ? _network->number_of_species() : _chem_array.size();
 }
\ No newline at end of file
@@ -1,12 +1,27 @@
 #pragma once
+#include <memory>
 #include <vector>
 #include "ChemSpecies.h"
+#include "ReactionNetwork.h"
 #include <string>
 
+/*
+Chemistry data, one species per row: A (s^-1), Ea (kcal), proportion, dH (J/mol), molar_mass (kg/mol).
+A row may also give an Ea spread (kcal) and a number of components, for a Gaussian distribution of Ea split into
+that many species (see CSVFileData.cpp). A discrete spectrum of Ea is simply one row per Ea; if the rows share A
+and are equally spaced in Ea, the solver evaluates them together (see ChemKinetics in ChemSpecies.h).
+
+A file of species and reaction lines is a reaction network instead (see ReactionNetwork.h). Its species are the
+chemistry fields of the solver, and _chem_array holds the rate constant and enthalpy of each reaction.
+*/
 class CSVFileData
 {
 public:
 	std::vector<ChemSpecies> _chem_array;
+	// the reaction network, or nullptr for independent species
+	std::shared_ptr<ReactionNetwork const> _network;
 	CSVFileData(std::string path);
+	// species made in memory rather than read from a file
+	CSVFileData(std::vector<ChemSpecies> const& chem_array);
 	size_t number_of_species();
 };
@@ -18,14 +18,25 @@ alpha, in joules per kg, is the amount of energy produced by converting
 1 kg of this kerogen.
 dH < 0 implies exothermic, dH > 0 is endothermic.
 */
-double ChemSpecies::alpha()
+double ChemSpecies::alpha() const
 {
 	return m_dH * (m_proportion/100) / m_molar_mass;
 }
 
-double ChemSpecies::k(double temp)
+double ChemSpecies::temperature_for_k(double k) const
 {
-	return m_A * exp(-m_Ea / (R * temp));
+	// k rises with temperature towards A, which it never reaches
+	return (k < m_A) ? m_Ea / (R * std::log(m_A / k)) : INFINITY;
+}
+
+double ChemSpecies::A() const
+{
+	return m_A;
+}
+
+double ChemSpecies::Ea() const
+{
+	return m_Ea;
 }
 
 double ChemSpecies::proportion()
@@ -41,4 +52,44 @@ void ChemSpecies::print()
 	std::cout << "proportion = " << m_proportion << '\n';
 	std::cout << "dH = " << m_dH << '\n';
 	std::cout << "molar mass = " << m_molar_mass << '\n';
-}
\ No newline at end of file
+}
+/*
+ChemKinetics
+*/
+
+ChemKinetics::ChemKinetics(std::vector<ChemSpecies> const& chem_species_array)
+	: ChemKinetics(chem_species_array, std::vector<bool>(chem_species_array.size(), true))
+{
+}
+
+ChemKinetics::ChemKinetics(std::vector<ChemSpecies> const& chem_species_array, std::vector<bool> const& active)
+{
+	for (size_t species = 0; species < chem_species_array.size(); species++)
+	{
+		if (not active[species])
+		{
+			continue;
+		}
+		ChemSpecies const& next = chem_species_array[species];
+		if (not _ladders.empty())
+		{
+			// join the last ladder if next follows on from it, has its A and continues its spacing of Ea
+			Ladder& ladder = _ladders.back();
+			double const last_Ea = ladder.Ea + (ladder.count - 1) * ladder.dEa;
+			double const dEa = next.Ea() - last_Ea;
+			bool const same_spacing = (ladder.count == 1) or std::abs(dEa - ladder.dEa) <= 1e-9 * std::abs(next.Ea());
+			if (species == ladder.first + ladder.count and next.A() == ladder.A and dEa != 0 and same_spacing)
+			{
+				ladder.dEa = (ladder.count == 1) ? dEa : ladder.dEa;
+				ladder.count++;
+				continue;
+			}
+		}
+		_ladders.push_back({ species, 1, next.A(), next.Ea(), 0.0 });
+	}
+}
+
+size_t ChemKinetics::number_of_ladders() const
+{
+	return _ladders.size();
+}
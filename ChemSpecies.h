@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <vector>
 
 class ChemSpecies
 {
@@ -14,8 +15,68 @@ private:
 
 public:
 	ChemSpecies(double A, double Ea, double proportion, double dH, double molar_mass);
-	double alpha();
-	double k(double temp);
+	double alpha() const;
+	double k(double temp) const;
+	// temperature (in Kelvin) below which the rate constant is less than k
+	double temperature_for_k(double k) const;
+	double A() const;
+	double Ea() const;
 	double proportion();
 	void print();
-};
\ No newline at end of file
+};
+
+// defined here so it can be inlined into the solver's update kernel
+inline double ChemSpecies::k(double temp) const
+{
+	return m_A * exp(-m_Ea / (R * temp));
+}
+
+/*
+Rate constants of a list of species, for the update kernels.
+A distributed activation energy model has many species sharing one A with equally spaced Ea (see CSVFileData.h).
+Consecutive species like this form a ladder, along which
+	k_(j+1) = k_j exp(-dEa / RT),
+so each ladder costs two exps per point, however many species are on it, rather than one exp per species.
+A species on its own gets exactly ChemSpecies::k.
+*/
+class ChemKinetics
+{
+private:
+	struct Ladder
+	{
+		size_t first;
+		size_t count;
+		double A;
+		double Ea;
+		double dEa;
+	};
+	std::vector<Ladder> _ladders;
+	double R = 8.314472;
+
+public:
+	ChemKinetics(std::vector<ChemSpecies> const& chem_species_array);
+	// only the species marked active, which are visited with their index in chem_species_array
+	ChemKinetics(std::vector<ChemSpecies> const& chem_species_array, std::vector<bool> const& active);
+
+	// Call visit(species, k) for every species in order, with its rate constant at temp (in Kelvin)
+	template <typename F>
+	void for_each_k(double const temp, F&& visit) const;
+
+	size_t number_of_ladders() const;
+};
+
+// defined here so it can be inlined into the solver's update kernel
+template <typename F>
+inline void ChemKinetics::for_each_k(double const temp, F&& visit) const
+{
+	for (auto const& ladder : _ladders)
+	{
+		double k = ladder.A * exp(-ladder.Ea / (R * temp));
+		double const step = (ladder.count > 1) ? exp(-ladder.dEa / (R * temp)) : 1.0;
+		for (size_t species = ladder.first; species < ladder.first + ladder.count; species++)
+		{
+			visit(species, k);
+			k *= step;
+		}
+	}
+}
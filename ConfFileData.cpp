@@ -3,6 +3,9 @@
 #include <fstream>
 #include <iostream>
 #include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <filesystem>
 #include "ConfFileData.h"
 #include "Log.h"
 
@@ -23,6 +26,17 @@ ConfFileData::ConfFileData(std::string path)
 		exit(1);
 	}
 
+	read(conf_file);
+	conf_file.close();
+}
+
+ConfFileData::ConfFileData(std::istream& conf_file)
+{
+	read(conf_file);
+}
+
+void ConfFileData::read(std::istream& conf_file)
+{
 	// Put variables from file into collections of variables of same type
 	std::string line;
 	std::map<std::string, size_t> int_variables;
@@ -86,8 +100,6 @@ ConfFileData::ConfFileData(std::string path)
 		}
 	}
 
-	conf_file.close();
-
 	// Now use constructed maps to generate ConfFileData members, raising an error
 	// if we don't find what we need
 	// int variables
@@ -98,35 +110,76 @@ ConfFileData::ConfFileData(std::string path)
 	set_variable<size_t>(_x_meshsize, "cuboid_x_meshsize", int_variables);
 	set_variable<size_t>(_y_meshsize, "cuboid_y_meshsize", int_variables);
 	set_variable<size_t>(_z_meshsize, "cuboid_z_meshsize", int_variables);
+	set_variable<size_t>(_spatial_order, "spatial_order", int_variables);
+	set_variable<size_t>(_tuning_timesteps, "tuning_timesteps", int_variables);
+	set_variable<size_t>(_amr_block_size, "amr_block_size", int_variables);
+	set_variable<size_t>(_amr_regrid_steps, "amr_regrid_steps", int_variables);
 	set_variable<size_t>(_heating_time, "heating_time", int_variables);
 	set_variable<size_t>(_timesteps_per_second, "timesteps_per_second", int_variables);
+	set_variable<size_t>(_max_timestep_reductions, "max_timestep_reductions", int_variables);
+	set_variable<size_t>(_linear_solver_max_iterations, "linear_solver_max_iterations", int_variables);
+	set_variable<size_t>(_cooling_timesteps_per_second, "cooling_timesteps_per_second", int_variables);
 	set_variable<size_t>(_significant_digits, "significant_digits", int_variables);
+	set_variable<size_t>(_probe_samples_per_second, "probe_samples_per_second", int_variables);
 
 	// double variables
 	set_variable<double>(_sphere_radius, "sphere_radius", double_variables);
 	set_variable<double>(_cylinder_radius, "cylinder_radius", double_variables);
 	set_variable<double>(_cylinder_height, "cylinder_height", double_variables);
+	set_variable<double>(_radial_grading_factor, "radial_grading_factor", double_variables);
 	set_variable<double>(_x_length, "cuboid_x_length", double_variables);
 	set_variable<double>(_y_length, "cuboid_y_length", double_variables);
 	set_variable<double>(_z_length, "cuboid_z_length", double_variables);
+	set_variable<double>(_amr_refine_temp_jump, "amr_refine_temp_jump", double_variables);
+	set_variable<double>(_amr_refine_chem_rate, "amr_refine_chem_rate", double_variables);
+	set_variable<double>(_equilibrium_max_rate, "equilibrium_max_rate", double_variables);
+	set_variable<double>(_equilibrium_rms_rate, "equilibrium_rms_rate", double_variables);
+	set_variable<double>(_divergence_max_rate, "divergence_max_rate", double_variables);
+	set_variable<double>(_timestep_safety_factor, "timestep_safety_factor", double_variables);
+	set_variable<double>(_linear_solver_tolerance, "linear_solver_tolerance", double_variables);
 	set_variable<double>(_max_temp, "max_temp", double_variables);
 	set_variable<double>(_initial_temp, "initial_temp", double_variables);
 	set_variable<double>(_heating_rate, "heating_rate", double_variables);
 	set_variable<double>(_thermal_conductivity, "thermal_conductivity", double_variables);
 	set_variable<double>(_specific_heat_capacity, "specific_heat_capacity", double_variables);
 	set_variable<double>(_rock_density, "rock_density", double_variables);
+	set_variable<double>(_property_table_tolerance, "property_table_tolerance", double_variables);
+	set_variable<double>(_property_refresh_threshold, "property_refresh_threshold", double_variables);
 	set_variable<double>(_kerogen_density, "kerogen_density", double_variables);
 	set_variable<double>(_TOC, "TOC_percent", double_variables);
+	set_variable<double>(_chemistry_skip_tolerance, "chemistry_skip_tolerance", double_variables);
+	set_variable<double>(_metrics_interval, "metrics_interval", double_variables);
 
 	// bool variables
+	set_variable<bool>(_symmetry_reduction, "symmetry_reduction", bool_variables);
+	set_variable<bool>(_richardson_on, "richardson_on", bool_variables);
+	set_variable<bool>(_amr_on, "amr_on", bool_variables);
+	set_variable<bool>(_mixed_precision, "mixed_precision", bool_variables);
+	set_variable<bool>(_mixed_precision_check, "mixed_precision_check", bool_variables);
+	set_variable<bool>(_deterministic_reductions, "deterministic_reductions", bool_variables);
+	set_variable<bool>(_thread_count_check, "thread_count_check", bool_variables);
+	set_variable<bool>(_auto_tune, "auto_tune", bool_variables);
+	set_variable<bool>(_amr_output_uniform, "amr_output_uniform", bool_variables);
+	set_variable<bool>(_auto_timestep, "auto_timestep", bool_variables);
+	set_variable<bool>(_large_step_cooling, "large_step_cooling", bool_variables);
 	set_variable<bool>(_fixed_max_temperature, "fixed_max_temperature", bool_variables);
 	set_variable<bool>(_fixed_thermal_conductivity, "fixed_thermal_conductivity", bool_variables);
 	set_variable<bool>(_fixed_specific_heat_capacity, "fixed_specific_heat_capacity", bool_variables);
 	set_variable<bool>(_cooling_phase, "cooling_phase", bool_variables);
 	set_variable<bool>(_chemistry_on, "chemistry_on", bool_variables);
+	set_variable<bool>(_field_output, "field_output", bool_variables);
+	set_variable<bool>(_summary_output, "summary_output", bool_variables);
 
 	// string variables
+	set_variable<std::string>(_radial_grading, "radial_grading", string_variables);
+	set_variable<std::string>(_time_integration, "time_integration", string_variables);
+	set_variable<std::string>(_linear_solver, "linear_solver", string_variables);
+	set_variable<std::string>(_tuning_cache, "tuning_cache", string_variables);
 	set_variable<std::string>(_chemistry_file, "chemistry_file", string_variables);
+	set_variable<std::string>(_output_directory, "output_directory", string_variables);
+	set_variable<std::string>(_conversion_levels, "conversion_levels", string_variables);
+	set_variable<std::string>(_probes, "probes", string_variables);
+	set_variable<std::string>(_metrics_file, "metrics_file", string_variables);
 	set_variable<std::string>(_log_level, "log_level", string_variables);
 	set_variable<std::string>(_log_filename, "log_filename", string_variables);
 }
@@ -149,6 +202,14 @@ void ConfFileData::check_input(std::ofstream& log_file)
 	{
 		Log::error_write(log_file, "Cylinder height meshsize must be greater than 1.\n");
 	}
+	if (not (_radial_grading == "uniform" or _radial_grading == "geometric" or _radial_grading == "tanh"))
+	{
+		Log::error_write(log_file, "Unrecognised radial_grading input.\n");
+	}
+	if (_radial_grading_factor <= 0)
+	{
+		Log::error_write(log_file, "Radial grading factor must be positive.\n");
+	}
 	if (_x_meshsize == 1)
 	{
 		Log::error_write(log_file, "x meshsize must be greater than 1.\n");
@@ -185,6 +246,149 @@ void ConfFileData::check_input(std::ofstream& log_file)
 	{
 		Log::error_write(log_file, "Cuboid length in z-direction must be positive.\n");
 	}
+	if (_symmetry_reduction)
+	{
+		if (_geometry == 2 and _cylinder_height_meshsize % 2 == 0)
+		{
+			Log::error_write(log_file, "With symmetry_reduction=true, cylinder height meshsize must be odd.\n");
+		}
+		if (_geometry == 3 and (_x_meshsize % 2 == 0 or _y_meshsize % 2 == 0 or _z_meshsize % 2 == 0))
+		{
+			Log::error_write(log_file, "With symmetry_reduction=true, cuboid meshsizes must be odd.\n");
+		}
+		if (_amr_on)
+		{
+			Log::error_write(log_file, "symmetry_reduction can't be used together with amr_on.\n");
+		}
+	}
+	if (not (_spatial_order == 2 or _spatial_order == 4))
+	{
+		Log::error_write(log_file, "Spatial order must be 2 or 4.\n");
+	}
+	if (_spatial_order == 4)
+	{
+		if (_radial_grading != "uniform")
+		{
+			Log::error_write(log_file, "spatial_order=4 needs radial_grading=\"uniform\".\n");
+		}
+		if ((_geometry == 1 and _sphere_radial_meshsize < 7)
+			or (_geometry == 2 and (_cylinder_radial_meshsize < 7 or _cylinder_height_meshsize < 7))
+			or (_geometry == 3 and (_x_meshsize < 7 or _y_meshsize < 7 or _z_meshsize < 7)))
+		{
+			Log::error_write(log_file, "With spatial_order=4, meshsizes must be at least 7.\n");
+		}
+		if (_amr_on)
+		{
+			Log::error_write(log_file, "spatial_order=4 can't be used together with amr_on.\n");
+		}
+		if (_time_integration == "implicit")
+		{
+			Log::error_write(log_file, "spatial_order=4 can't be used together with time_integration=\"implicit\".\n");
+		}
+	}
+	if (_richardson_on)
+	{
+		if (_spatial_order != 2)
+		{
+			Log::error_write(log_file, "richardson_on needs spatial_order=2.\n");
+		}
+		if (_amr_on)
+		{
+			Log::error_write(log_file, "richardson_on can't be used together with amr_on.\n");
+		}
+	}
+	if (_mixed_precision_check)
+	{
+		if (not _mixed_precision)
+		{
+			Log::error_write(log_file, "mixed_precision_check needs mixed_precision=true.\n");
+		}
+		if (_richardson_on or _amr_on)
+		{
+			Log::error_write(log_file, "mixed_precision_check can't be used together with richardson_on or amr_on.\n");
+		}
+	}
+	if (_thread_count_check)
+	{
+		if (not _deterministic_reductions)
+		{
+			Log::error_write(log_file, "thread_count_check needs deterministic_reductions=true.\n");
+		}
+		if (_richardson_on or _mixed_precision_check or _amr_on)
+		{
+			Log::error_write(log_file,
+				"thread_count_check can't be used together with richardson_on, mixed_precision_check or amr_on.\n");
+		}
+	}
+	if (_auto_tune)
+	{
+		if (_tuning_timesteps < 1)
+		{
+			Log::error_write(log_file, "tuning_timesteps must be at least 1.\n");
+		}
+		if (_richardson_on or _mixed_precision_check or _thread_count_check or _amr_on)
+		{
+			Log::error_write(log_file, "auto_tune can't be used together with richardson_on, mixed_precision_check, "
+				"thread_count_check or amr_on.\n");
+		}
+	}
+	if (_amr_on)
+	{
+		if (_geometry != 3)
+		{
+			Log::error_write(log_file, "Adaptive mesh refinement is only available for the cuboid (geometry=3).\n");
+		}
+		if (_amr_block_size < 2)
+		{
+			// so refined regions have coarse points inside, and no coarse flux runs through one between its surface points
+			Log::error_write(log_file, "AMR block size must be at least 2.\n");
+		}
+		else if ((_x_meshsize - 1) % (2 * _amr_block_size) != 0 or (_y_meshsize - 1) % (2 * _amr_block_size) != 0
+			or (_z_meshsize - 1) % (2 * _amr_block_size) != 0)
+		{
+			Log::error_write(log_file, "With amr_on=true, each cuboid meshsize minus 1 must be a multiple of twice amr_block_size.\n");
+		}
+		if (_amr_regrid_steps < 1)
+		{
+			Log::error_write(log_file, "AMR regrid steps must be at least 1.\n");
+		}
+	}
+	if (_equilibrium_max_rate <= 0 or _equilibrium_rms_rate <= 0)
+	{
+		Log::error_write(log_file, "Equilibrium tolerances must be positive.\n");
+	}
+	if (_divergence_max_rate <= 0)
+	{
+		Log::error_write(log_file, "Divergence threshold must be positive.\n");
+	}
+	if (_timestep_safety_factor <= 0 or _timestep_safety_factor > 1)
+	{
+		Log::error_write(log_file, "Timestep safety factor must be greater than 0 and at most 1.\n");
+	}
+	if (not (_time_integration == "explicit" or _time_integration == "implicit"))
+	{
+		Log::error_write(log_file, "Unrecognised time_integration input.\n");
+	}
+	if (_large_step_cooling and _cooling_timesteps_per_second < 1)
+	{
+		Log::error_write(log_file, "Cooling timesteps per second must be at least 1.\n");
+	}
+	if (_time_integration == "implicit" and (_geometry != 3 or _amr_on))
+	{
+		Log::error_write(log_file, "Implicit time integration is only available for the cuboid (geometry=3) without amr_on.\n");
+	}
+	if (not (_linear_solver == "pcg" or _linear_solver == "multigrid" or _linear_solver == "mgcg"))
+	{
+		Log::error_write(log_file, "Unrecognised linear_solver input.\n");
+	}
+	if (_linear_solver_tolerance <= 0)
+	{
+		Log::error_write(log_file, "Linear solver tolerance must be positive.\n");
+	}
+	if (_linear_solver_max_iterations < 1)
+	{
+		Log::error_write(log_file, "Linear solver max iterations must be at least 1.\n");
+	}
 	if (_max_temp < 0)
 	{
 		Log::error_write(log_file, "Max temperature must be positive.\n");
@@ -201,6 +405,14 @@ void ConfFileData::check_input(std::ofstream& log_file)
 	{
 		Log::error_write(log_file, "Rock density must be positive.\n");
 	}
+	if (_property_table_tolerance <= 0)
+	{
+		Log::error_write(log_file, "Property table tolerance must be positive.\n");
+	}
+	if (_property_refresh_threshold < 0)
+	{
+		Log::error_write(log_file, "Property refresh threshold must not be negative.\n");
+	}
 	if (_kerogen_density < 0)
 	{
 		Log::error_write(log_file, "Kerogen density must be positive.\n");
@@ -209,6 +421,52 @@ void ConfFileData::check_input(std::ofstream& log_file)
 	{
 		Log::error_write(log_file, "TOC must be a real value between 0.0 and 100.0.\n");
 	}
+	if (_chemistry_skip_tolerance < 0)
+	{
+		Log::error_write(log_file, "Chemistry skip tolerance must not be negative.\n");
+	}
+	if (_amr_on and (_summary_output or not _field_output))
+	{
+		Log::error_write(log_file, "amr_on needs field_output=true and summary_output=false.\n");
+	}
+	for (double const level : conversion_levels())
+	{
+		if (not (level > 0.0 and level < 100.0))
+		{
+			Log::error_write(log_file, "conversion_levels must be a list of percentages between 0 and 100.\n");
+		}
+	}
+	std::vector<std::vector<double>> const probes = probe_positions();
+	if (not probes.empty())
+	{
+		if (_amr_on)
+		{
+			Log::error_write(log_file, "probes can't be used together with amr_on.\n");
+		}
+		if (_probe_samples_per_second == 0)
+		{
+			Log::error_write(log_file, "probe_samples_per_second must be positive.\n");
+		}
+	}
+	for (auto const& probe : probes)
+	{
+		if (probe.size() != _geometry)
+		{
+			Log::error_write(log_file, "Each probe needs " + std::to_string(_geometry)
+				+ " coordinate(s) for this geometry: r (sphere), r,z (cylinder) or x,y,z (cuboid).\n");
+		}
+	}
+	if (not _metrics_file.empty())
+	{
+		if (_amr_on)
+		{
+			Log::error_write(log_file, "metrics_file can't be used together with amr_on.\n");
+		}
+		if (_metrics_interval <= 0)
+		{
+			Log::error_write(log_file, "metrics_interval must be positive.\n");
+		}
+	}
 }
 void ConfFileData::log_input(std::ofstream& log_file)
 {
@@ -222,34 +480,151 @@ void ConfFileData::log_input(std::ofstream& log_file)
 	log_file << "x_meshsize=" << this->_x_meshsize << '\n';
 	log_file << "y_meshsize=" << this->_y_meshsize << '\n';
 	log_file << "z_meshsize=" << this->_z_meshsize << '\n';
+	log_file << "spatial_order=" << this->_spatial_order << '\n';
+	log_file << "tuning_timesteps=" << this->_tuning_timesteps << '\n';
+	log_file << "amr_block_size=" << this->_amr_block_size << '\n';
+	log_file << "amr_regrid_steps=" << this->_amr_regrid_steps << '\n';
 	log_file << "heating_time=" << this->_heating_rate << '\n';
 	log_file << "timesteps_per_second=" << this->_timesteps_per_second << '\n';
+	log_file << "max_timestep_reductions=" << this->_max_timestep_reductions << '\n';
+	log_file << "linear_solver_max_iterations=" << this->_linear_solver_max_iterations << '\n';
+	log_file << "cooling_timesteps_per_second=" << this->_cooling_timesteps_per_second << '\n';
 	log_file << "significant_digits=" << this->_significant_digits << '\n';
+	log_file << "probe_samples_per_second=" << this->_probe_samples_per_second << '\n';
+	log_file << "output_directory=" << this->_output_directory << '\n';
 
 	log_file << "--Double variables--\n";
 	log_file << "cylinder_radius=" << this->_cylinder_radius << '\n';
 	log_file << "cylinder_height=" << this->_cylinder_height << '\n';
+	log_file << "radial_grading_factor=" << this->_radial_grading_factor << '\n';
 	log_file << "x_length=" << this->_x_length << '\n';
 	log_file << "y_length=" << this->_y_length << '\n';
 	log_file << "z_length=" << this->_z_length << '\n';
+	log_file << "amr_refine_temp_jump=" << this->_amr_refine_temp_jump << '\n';
+	log_file << "amr_refine_chem_rate=" << this->_amr_refine_chem_rate << '\n';
+	log_file << "equilibrium_max_rate=" << this->_equilibrium_max_rate << '\n';
+	log_file << "equilibrium_rms_rate=" << this->_equilibrium_rms_rate << '\n';
+	log_file << "divergence_max_rate=" << this->_divergence_max_rate << '\n';
+	log_file << "timestep_safety_factor=" << this->_timestep_safety_factor << '\n';
+	log_file << "linear_solver_tolerance=" << this->_linear_solver_tolerance << '\n';
 	log_file << "max_temp=" << this->_max_temp << '\n';
 	log_file << "initial_temp=" << this->_initial_temp << '\n';
 	log_file << "heating_rate=" << this->_heating_rate << '\n';
 	log_file << "thermal_conductivity=" << this->_thermal_conductivity << '\n';
 	log_file << "specific_heat_capacity=" << this->_specific_heat_capacity << '\n';
 	log_file << "rock_density=" << this->_rock_density << '\n';
+	log_file << "property_table_tolerance=" << this->_property_table_tolerance << '\n';
+	log_file << "property_refresh_threshold=" << this->_property_refresh_threshold << '\n';
 	log_file << "kerogen_density=" << this->_kerogen_density << '\n';
 	log_file << "TOC=" << this->_TOC << '\n';
+	log_file << "chemistry_skip_tolerance=" << this->_chemistry_skip_tolerance << '\n';
+	log_file << "metrics_interval=" << this->_metrics_interval << '\n';
 
 	log_file << "--Bool variables--\n";
+	log_file << "symmetry_reduction=" << this->_symmetry_reduction << '\n';
+	log_file << "richardson_on=" << this->_richardson_on << '\n';
+	log_file << "amr_on=" << this->_amr_on << '\n';
+	log_file << "mixed_precision=" << this->_mixed_precision << '\n';
+	log_file << "mixed_precision_check=" << this->_mixed_precision_check << '\n';
+	log_file << "deterministic_reductions=" << this->_deterministic_reductions << '\n';
+	log_file << "thread_count_check=" << this->_thread_count_check << '\n';
+	log_file << "auto_tune=" << this->_auto_tune << '\n';
+	log_file << "amr_output_uniform=" << this->_amr_output_uniform << '\n';
+	log_file << "auto_timestep=" << this->_auto_timestep << '\n';
+	log_file << "large_step_cooling=" << this->_large_step_cooling << '\n';
 	log_file << "fixed_max_temperature=" << this->_fixed_max_temperature << '\n';
 	log_file << "fixed_thermal_conductivity=" << this->_fixed_thermal_conductivity << '\n';
 	log_file << "fixed_specific_heat_capacity=" << this->_fixed_specific_heat_capacity << '\n';
 	log_file << "cooling_phase=" << this->_cooling_phase << '\n';
 	log_file << "chemistry_on=" << this->_chemistry_on << '\n';
+	log_file << "field_output=" << this->_field_output << '\n';
+	log_file << "summary_output=" << this->_summary_output << '\n';
 
 	log_file << "--String variables--\n";
+	log_file << "radial_grading=" << this->_radial_grading << '\n';
+	log_file << "time_integration=" << this->_time_integration << '\n';
+	log_file << "linear_solver=" << this->_linear_solver << '\n';
+	log_file << "tuning_cache=" << this->_tuning_cache << '\n';
 	log_file << "chemistry_file=" << this->_chemistry_file << '\n';
+	log_file << "conversion_levels=" << this->_conversion_levels << '\n';
+	log_file << "probes=" << this->_probes << '\n';
+	log_file << "metrics_file=" << this->_metrics_file << '\n';
 	log_file << "log_level=" << this->_log_level << '\n';
 	log_file << "log_filename=" << this->_log_filename << '\n';
-}
\ No newline at end of file
+}
+double ConfFileData::peak_temperature() const
+{
+	double peak_temp = _initial_temp + (_heating_rate / 60) * _heating_time;
+	if (_fixed_max_temperature and _max_temp < peak_temp)
+	{
+		peak_temp = _max_temp;
+	}
+	return peak_temp;
+}
+size_t ConfFileData::heating_timesteps() const
+{
+	size_t time_meshsize = _heating_time * _timesteps_per_second;
+	if (_fixed_max_temperature)
+	{
+		size_t timesteps_to_reach_max =
+			static_cast<size_t>(((_max_temp - _initial_temp) / (_heating_rate / 60)) * _timesteps_per_second) + 1;
+		if (timesteps_to_reach_max < time_meshsize)
+		{
+			time_meshsize = timesteps_to_reach_max;
+		}
+	}
+	return time_meshsize;
+}
+std::string ConfFileData::output_path(std::string const& filename) const
+{
+	if (_output_directory.empty())
+	{
+		return filename;
+	}
+	return (std::filesystem::path(_output_directory) / filename).string();
+}
+void ConfFileData::create_output_directory() const
+{
+	if (not _output_directory.empty())
+	{
+		std::filesystem::create_directories(_output_directory);
+	}
+}
+std::vector<double> ConfFileData::conversion_levels() const
+{
+	// a comma separated list, such as "10,50,90"
+	std::vector<double> levels;
+	std::stringstream levels_stream(_conversion_levels);
+	std::string level;
+	while (std::getline(levels_stream, level, ','))
+	{
+		if (level.find_first_not_of(" \t") != std::string::npos)
+		{
+			levels.push_back(std::atof(level.c_str()));
+		}
+	}
+	return levels;
+}
+std::vector<std::vector<double>> ConfFileData::probe_positions() const
+{
+	// probes separated by semicolons, each a comma separated list of coordinates, such as "0,0;50,100"
+	std::vector<std::vector<double>> positions;
+	std::stringstream probes_stream(_probes);
+	std::string probe;
+	while (std::getline(probes_stream, probe, ';'))
+	{
+		if (probe.find_first_not_of(" \t") == std::string::npos)
+		{
+			continue;
+		}
+		std::vector<double> position;
+		std::stringstream probe_stream(probe);
+		std::string coordinate;
+		while (std::getline(probe_stream, coordinate, ','))
+		{
+			position.push_back(std::atof(coordinate.c_str()));
+		}
+		positions.push_back(position);
+	}
+	return positions;
+}
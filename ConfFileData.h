@@ -2,61 +2,132 @@
 #include <map>
 #include <string>
 #include <fstream>
+#include <istream>
+#include <vector>
 
 struct ConfFileData
 {
+	// (each setting defaults to its value in the settings.conf shipped with the solver, so settings written before a
+	// key was added, or made in memory with only a few keys, still load)
+
 	// Domain settings
-	size_t _geometry;
+	size_t _geometry = 1;
 	
-	double _sphere_radius;
-	size_t _sphere_radial_meshsize;
+	double _sphere_radius = 100.0;
+	size_t _sphere_radial_meshsize = 11;
+
+	double _cylinder_radius = 100.0;
+	double _cylinder_height = 100.0;
+	size_t _cylinder_radial_meshsize = 11;
+	size_t _cylinder_height_meshsize = 11;
+
+	std::string _radial_grading = "uniform";
+	double _radial_grading_factor = 0.9;
+
+	double _x_length = 500.0;
+	double _y_length = 500.0;
+	double _z_length = 500.0;
+	size_t _x_meshsize = 11;
+	size_t _y_meshsize = 11;
+	size_t _z_meshsize = 11;
+
+	bool _symmetry_reduction = false;
 
-	double _cylinder_radius;
-	double _cylinder_height;
-	size_t _cylinder_radial_meshsize;
-	size_t _cylinder_height_meshsize;
+	size_t _spatial_order = 2;
 
-	double _x_length;
-	double _y_length;
-	double _z_length;
-	size_t _x_meshsize;
-	size_t _y_meshsize;
-	size_t _z_meshsize;
+	bool _richardson_on = false;
+
+	// Storage settings
+	bool _mixed_precision = false;
+	bool _mixed_precision_check = false;
+
+	bool _deterministic_reductions = false;
+	bool _thread_count_check = false;
+	bool _auto_tune = false;
+	size_t _tuning_timesteps = 200;
+	std::string _tuning_cache = "tuning_cache.txt";
+
+	bool _amr_on = false;
+	size_t _amr_block_size = 4;
+	size_t _amr_regrid_steps = 100;
+	double _amr_refine_temp_jump = 1.0;
+	double _amr_refine_chem_rate = 1.0e-3;
+	bool _amr_output_uniform = true;
 
 	// Time settings
-	size_t _heating_time;
-	size_t _timesteps_per_second;
+	size_t _heating_time = 50;
+	size_t _timesteps_per_second = 50000;
+	double _equilibrium_max_rate = 1.0e-6;
+	double _equilibrium_rms_rate = 1.0e-7;
+	double _divergence_max_rate = 1000.0;
+	size_t _max_timestep_reductions = 4;
+	bool _auto_timestep = true;
+	double _timestep_safety_factor = 0.8;
+	std::string _time_integration = "explicit";
+	std::string _linear_solver = "mgcg";
+	double _linear_solver_tolerance = 1.0e-8;
+	size_t _linear_solver_max_iterations = 200;
+	bool _large_step_cooling = false;
+	size_t _cooling_timesteps_per_second = 10;
 
 	// Physics settings
-	bool _fixed_max_temperature;
-	bool _fixed_thermal_conductivity;
-	bool _fixed_specific_heat_capacity;
-	double _max_temp;
-	double _initial_temp;
-	double _heating_rate;
-	bool _cooling_phase;
-	double _thermal_conductivity;
-	double _specific_heat_capacity;
-	double _rock_density;
+	bool _fixed_max_temperature = false;
+	bool _fixed_thermal_conductivity = false;
+	bool _fixed_specific_heat_capacity = false;
+	double _max_temp = 600.0;
+	double _initial_temp = 20.0;
+	double _heating_rate = 50.0;
+	bool _cooling_phase = true;
+	double _thermal_conductivity = 1.2;
+	double _specific_heat_capacity = 900.0;
+	double _rock_density = 2500.0;
+	double _property_table_tolerance = 1.0e-6;
+	double _property_refresh_threshold = 0.01;
 
 	// Chemistry settings
-	bool _chemistry_on;
-	std::string _chemistry_file;
-	double _kerogen_density;
-	double _TOC;
+	bool _chemistry_on = true;
+	std::string _chemistry_file = "sample_chem.csv";
+	double _kerogen_density = 900.0;
+	double _TOC = 5.0;
+	double _chemistry_skip_tolerance = 1.0e-12;
 
 	// Output settings
-	size_t _significant_digits;
+	size_t _significant_digits = 12;
+	std::string _output_directory = "";
+	bool _field_output = true;
+	bool _summary_output = false;
+	std::string _conversion_levels = "10,50,90";
+	std::string _probes = "";
+	size_t _probe_samples_per_second = 10;
+	std::string _metrics_file = "";
+	double _metrics_interval = 5.0;
 
 	// Logging settings
-	std::string _log_level;
-	std::string _log_filename;
+	std::string _log_level = "normal";
+	std::string _log_filename = "logfile.txt";
 
-	// Constructor
+	// Constructors, reading settings in the format of settings.conf from the file at path or from a stream
 	ConfFileData(std::string path);
+	ConfFileData(std::istream& conf_file);
 
 	void check_input(std::ofstream& log_file);
 	void log_input(std::ofstream& log_file);
+
+	// Highest temperature (in Celsius) the boundary reaches during heating
+	double peak_temperature() const;
+	// Number of timesteps in the heating phase
+	size_t heating_timesteps() const;
+	// Path of an output or log file called filename, in output_directory
+	std::string output_path(std::string const& filename) const;
+	// Create output_directory if it doesn't exist
+	void create_output_directory() const;
+	// Percentages of conversion given in conversion_levels, whose times are logged with summary_output=true
+	std::vector<double> conversion_levels() const;
+	// Positions of the probes given in probes, each a list of coordinates in microns
+	std::vector<std::vector<double>> probe_positions() const;
+
+private:
+	void read(std::istream& conf_file);
 };
 
 template <typename T>
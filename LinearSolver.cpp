@@ -0,0 +1,635 @@
+#include "LinearSolver.h"
+#include "ConfFileData.h"
+#include "Mesh.h"
+#include "Reductions.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// damping factor of the Jacobi smoother (close to the best value, 6/7, for the 3D Laplace operator)
+static double const JACOBI_DAMPING = 0.8;
+
+static std::string solver_statistics(size_t const solves, size_t const iterations, size_t const max_solve_iterations,
+	size_t const unconverged_solves, double const solve_seconds)
+{
+	std::string summary = std::to_string(solves) + " linear solves took " + std::to_string(iterations)
+		+ " iterations (mean " + std::to_string(solves ? static_cast<double>(iterations) / solves : 0.0)
+		+ ", max " + std::to_string(max_solve_iterations) + ") and "
+		+ std::to_string(solve_seconds) + " seconds.";
+	if (unconverged_solves > 0)
+	{
+		summary += " [WARNING]: " + std::to_string(unconverged_solves)
+			+ " solves did not converge within linear_solver_max_iterations.";
+	}
+	return summary;
+}
+
+/*
+MultigridLevel
+*/
+
+MultigridLevel::MultigridLevel(ConfFileData const& cf)
+	: conf_file_data(cf),
+	correction(conf_file_data, "multigrid_correction")
+{
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		size[axis] = correction.meshsize(axis);
+	}
+	laplacian_diagonal = correction.stability_weight();
+	inverse_diffusivity.resize(correction.size(), 0.0);
+	rhs.resize(correction.size(), 0.0);
+	product.resize(correction.size(), 0.0);
+
+	// points on a mid-plane only have half of their cell inside the solved part of the cuboid;
+	// boundary points have no unknowns and take no part in the inner product
+	weight.resize(correction.size(), 0.0);
+	for (size_t i = 0; i < size[0]; i++)
+	{
+		for (size_t j = 0; j < size[1]; j++)
+		{
+			for (size_t k = 0; k < size[2]; k++)
+			{
+				size_t const index = (i * size[1] + j) * size[2] + k;
+				if (correction.is_on_boundary(index))
+				{
+					continue;
+				}
+				size_t const point[3] = { i, j, k };
+				weight[index] = 1.0;
+				for (size_t axis = 0; axis < 3; axis++)
+				{
+					if (correction.is_mirrored(axis) and point[axis] == size[axis] - 1)
+					{
+						weight[index] *= 0.5;
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+CuboidLinearSolver
+*/
+
+CuboidLinearSolver::CuboidLinearSolver(ConfFileData& cf)
+	: _direction(cf, "cg_direction")
+{
+	_method = cf._linear_solver;
+	_tolerance = cf._linear_solver_tolerance;
+	_max_iterations = cf._linear_solver_max_iterations;
+	_deterministic = cf._deterministic_reductions;
+
+	_levels.push_back(MultigridLevel(cf));
+	if (_method != "pcg")
+	{
+		// coarsen while every axis has an even number of intervals (on both sides of the mid-plane of a
+		// symmetry reduced cuboid) and the coarse mesh still has interior points
+		size_t const factor = cf._symmetry_reduction ? 4 : 2;
+		while (true)
+		{
+			ConfFileData coarse_cf = _levels.back().conf_file_data;
+			size_t* meshsizes[3] = { &coarse_cf._x_meshsize, &coarse_cf._y_meshsize, &coarse_cf._z_meshsize };
+			bool coarsenable = true;
+			for (auto meshsize : meshsizes)
+			{
+				coarsenable = coarsenable and ((*meshsize - 1) % factor == 0) and ((*meshsize - 1) / 2 >= 2);
+			}
+			if (not coarsenable)
+			{
+				break;
+			}
+			for (auto meshsize : meshsizes)
+			{
+				*meshsize = (*meshsize - 1) / 2 + 1;
+			}
+			_levels.push_back(MultigridLevel(coarse_cf));
+		}
+	}
+
+	_direction.fill(0.0);
+	_residual.resize(_direction.size(), 0.0);
+	_preconditioned.resize(_direction.size(), 0.0);
+	_product.resize(_direction.size(), 0.0);
+}
+
+size_t CuboidLinearSolver::number_of_levels() const
+{
+	return _levels.size();
+}
+size_t CuboidLinearSolver::iterations() const
+{
+	return _iterations;
+}
+std::string CuboidLinearSolver::statistics() const
+{
+	return solver_statistics(_solves, _iterations, _max_solve_iterations, _unconverged_solves, _solve_seconds);
+}
+
+void CuboidLinearSolver::apply(MultigridLevel const& level, CuboidMesh const& u, std::vector<double>& product) const
+{
+	size_t const mesh_size = u.size();
+#pragma omp parallel for
+	for (size_t index = 0; index < mesh_size; index++)
+	{
+		if (u.is_on_boundary(index))
+		{
+			product[index] = 0.0;
+		}
+		else
+		{
+			product[index] = level.inverse_diffusivity[index] * u[index] - _dt * u.laplacian(index);
+		}
+	}
+}
+
+double CuboidLinearSolver::dot(MultigridLevel const& level, std::vector<double> const& a,
+	std::vector<double> const& b) const
+{
+	return parallel_sum(a.size(), _deterministic, [&](size_t const index)
+	{
+		return level.weight[index] * a[index] * b[index];
+	});
+}
+
+/*
+Multigrid
+Each level is solved for a correction with zero initial guess. Damped Jacobi is used for smoothing, with as
+many sweeps after the coarse correction as before, and restriction is the adjoint of trilinear prolongation,
+so that the V-cycle is symmetric and can precondition conjugate gradients. Coarse operators are rediscretised
+from the coarse mesh, with the diffusivity taken from the coinciding fine points.
+*/
+
+void CuboidLinearSolver::smooth(MultigridLevel& level, size_t const sweeps)
+{
+	size_t const mesh_size = level.correction.size();
+	for (size_t sweep = 0; sweep < sweeps; sweep++)
+	{
+		apply(level, level.correction, level.product);
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			if (level.weight[index] > 0.0)
+			{
+				level.correction[index] += JACOBI_DAMPING * (level.rhs[index] - level.product[index])
+					/ (level.inverse_diffusivity[index] + _dt * level.laplacian_diagonal);
+			}
+		}
+	}
+}
+
+void CuboidLinearSolver::restrict_residual(MultigridLevel const& fine, MultigridLevel& coarse) const
+{
+	// the residual of the fine level is held in fine.product
+#pragma omp parallel for
+	for (size_t I = 0; I < coarse.size[0]; I++)
+	{
+		for (size_t J = 0; J < coarse.size[1]; J++)
+		{
+			for (size_t K = 0; K < coarse.size[2]; K++)
+			{
+				size_t const coarse_index = (I * coarse.size[1] + J) * coarse.size[2] + K;
+				if (coarse.weight[coarse_index] == 0.0)
+				{
+					coarse.rhs[coarse_index] = 0.0;
+					continue;
+				}
+
+				// fine points within one fine spacing, weighted as in trilinear interpolation
+				// (there are none beyond a mid-plane)
+				double sum = 0.0;
+				for (size_t di = 0; di < 3; di++)
+				{
+					size_t const i = 2 * I + di - 1;
+					if (i >= fine.size[0])
+					{
+						continue;
+					}
+					for (size_t dj = 0; dj < 3; dj++)
+					{
+						size_t const j = 2 * J + dj - 1;
+						if (j >= fine.size[1])
+						{
+							continue;
+						}
+						for (size_t dk = 0; dk < 3; dk++)
+						{
+							size_t const k = 2 * K + dk - 1;
+							if (k >= fine.size[2])
+							{
+								continue;
+							}
+							size_t const fine_index = (i * fine.size[1] + j) * fine.size[2] + k;
+							double const interpolation_weight = (di == 1 ? 1.0 : 0.5) * (dj == 1 ? 1.0 : 0.5)
+								* (dk == 1 ? 1.0 : 0.5);
+							sum += interpolation_weight * fine.weight[fine_index] * fine.product[fine_index];
+						}
+					}
+				}
+				coarse.rhs[coarse_index] = sum / (8 * coarse.weight[coarse_index]);
+			}
+		}
+	}
+}
+
+void CuboidLinearSolver::prolong_correction(MultigridLevel const& coarse, MultigridLevel& fine) const
+{
+#pragma omp parallel for
+	for (size_t i = 0; i < fine.size[0]; i++)
+	{
+		for (size_t j = 0; j < fine.size[1]; j++)
+		{
+			for (size_t k = 0; k < fine.size[2]; k++)
+			{
+				size_t const fine_index = (i * fine.size[1] + j) * fine.size[2] + k;
+				if (fine.weight[fine_index] == 0.0)
+				{
+					continue;
+				}
+
+				// trilinear interpolation from the corners of the coarse cell containing this point
+				size_t const point[3] = { i, j, k };
+				double value = 0.0;
+				for (size_t corner = 0; corner < 8; corner++)
+				{
+					double interpolation_weight = 1.0;
+					size_t c[3];
+					for (size_t axis = 0; axis < 3; axis++)
+					{
+						size_t const bit = (corner >> axis) & 1;
+						bool const midpoint = (point[axis] % 2 == 1);
+						if (bit == 1 and not midpoint)
+						{
+							interpolation_weight = 0.0;
+							break;
+						}
+						interpolation_weight *= midpoint ? 0.5 : 1.0;
+						c[axis] = point[axis] / 2 + bit;
+					}
+					if (interpolation_weight > 0.0)
+					{
+						value += interpolation_weight
+							* coarse.correction[(c[0] * coarse.size[1] + c[1]) * coarse.size[2] + c[2]];
+					}
+				}
+				fine.correction[fine_index] += value;
+			}
+		}
+	}
+}
+
+void CuboidLinearSolver::v_cycle(size_t const l)
+{
+	MultigridLevel& level = _levels[l];
+	level.correction.fill(0.0);
+
+	if (l == _levels.size() - 1)
+	{
+		smooth(level, COARSEST_SWEEPS);
+		return;
+	}
+
+	smooth(level, SMOOTHING_SWEEPS);
+
+	// residual of this level, corrected on the next
+	size_t const mesh_size = level.correction.size();
+	apply(level, level.correction, level.product);
+#pragma omp parallel for
+	for (size_t index = 0; index < mesh_size; index++)
+	{
+		level.product[index] = (level.weight[index] > 0.0) ? level.rhs[index] - level.product[index] : 0.0;
+	}
+	restrict_residual(level, _levels[l + 1]);
+	v_cycle(l + 1);
+	prolong_correction(_levels[l + 1], level);
+
+	smooth(level, SMOOTHING_SWEEPS);
+}
+
+void CuboidLinearSolver::precondition()
+{
+	MultigridLevel& level = _levels[0];
+	size_t const mesh_size = _residual.size();
+	if (_method == "pcg")
+	{
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			_preconditioned[index] = _residual[index]
+				/ (level.inverse_diffusivity[index] + _dt * level.laplacian_diagonal);
+		}
+	}
+	else
+	{
+		level.rhs = _residual;
+		v_cycle(0);
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			_preconditioned[index] = level.correction[index];
+		}
+	}
+}
+
+/*
+Solvers
+Both stop once the norm of the residual is below linear_solver_tolerance times its initial value. Solves start
+from the temperature before the timestep, so the initial residual scales with the change over the timestep,
+and the solves stay accurate enough to measure rates of change close to equilibrium.
+*/
+
+size_t CuboidLinearSolver::conjugate_gradients(CuboidMesh& u, std::vector<double> const& rhs)
+{
+	MultigridLevel const& level = _levels[0];
+	size_t const mesh_size = u.size();
+
+	apply(level, u, _product);
+#pragma omp parallel for
+	for (size_t index = 0; index < mesh_size; index++)
+	{
+		_residual[index] = (level.weight[index] > 0.0) ? rhs[index] - _product[index] : 0.0;
+	}
+	double const threshold = _tolerance * std::sqrt(dot(level, _residual, _residual));
+	if (threshold == 0.0)
+	{
+		return 0;
+	}
+
+	precondition();
+#pragma omp parallel for
+	for (size_t index = 0; index < mesh_size; index++)
+	{
+		_direction[index] = (level.weight[index] > 0.0) ? _preconditioned[index] : 0.0;
+	}
+	double residual_dot_preconditioned = dot(level, _residual, _preconditioned);
+
+	for (size_t iteration = 1; iteration <= _max_iterations; iteration++)
+	{
+		apply(level, _direction, _product);
+		double const direction_dot_product = parallel_sum(mesh_size, _deterministic, [&](size_t const index)
+		{
+			return level.weight[index] * _direction[index] * _product[index];
+		});
+		double const alpha = residual_dot_preconditioned / direction_dot_product;
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			u[index] += alpha * _direction[index];
+			_residual[index] -= alpha * _product[index];
+		}
+		if (std::sqrt(dot(level, _residual, _residual)) <= threshold)
+		{
+			return iteration;
+		}
+
+		precondition();
+		double const new_residual_dot_preconditioned = dot(level, _residual, _preconditioned);
+		double const beta = new_residual_dot_preconditioned / residual_dot_preconditioned;
+		residual_dot_preconditioned = new_residual_dot_preconditioned;
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			_direction[index] = (level.weight[index] > 0.0) ? _preconditioned[index] + beta * _direction[index] : 0.0;
+		}
+	}
+	_unconverged_solves++;
+	return _max_iterations;
+}
+
+size_t CuboidLinearSolver::multigrid(CuboidMesh& u, std::vector<double> const& rhs)
+{
+	MultigridLevel& level = _levels[0];
+	size_t const mesh_size = u.size();
+
+	double threshold = 0.0;
+	for (size_t iteration = 0; iteration <= _max_iterations; iteration++)
+	{
+		apply(level, u, _product);
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			_residual[index] = (level.weight[index] > 0.0) ? rhs[index] - _product[index] : 0.0;
+		}
+		double const residual_norm = std::sqrt(dot(level, _residual, _residual));
+		if (iteration == 0)
+		{
+			threshold = _tolerance * residual_norm;
+		}
+		if (residual_norm <= threshold)
+		{
+			return iteration;
+		}
+		if (iteration == _max_iterations)
+		{
+			break;
+		}
+
+		level.rhs = _residual;
+		v_cycle(0);
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			u[index] += level.correction[index];
+		}
+	}
+	_unconverged_solves++;
+	return _max_iterations;
+}
+
+size_t CuboidLinearSolver::solve(CuboidMesh& u, std::vector<double> const& inverse_diffusivity,
+	std::vector<double> const& rhs, double const dt)
+{
+	auto clock_start = std::chrono::steady_clock::now();
+	_dt = dt;
+
+	// diffusivity on each level, taken from the coinciding points of the level above
+	_levels[0].inverse_diffusivity = inverse_diffusivity;
+	for (size_t l = 1; l < _levels.size(); l++)
+	{
+		MultigridLevel const& fine = _levels[l - 1];
+		MultigridLevel& coarse = _levels[l];
+#pragma omp parallel for
+		for (size_t I = 0; I < coarse.size[0]; I++)
+		{
+			for (size_t J = 0; J < coarse.size[1]; J++)
+			{
+				for (size_t K = 0; K < coarse.size[2]; K++)
+				{
+					coarse.inverse_diffusivity[(I * coarse.size[1] + J) * coarse.size[2] + K] =
+						fine.inverse_diffusivity[((2 * I) * fine.size[1] + 2 * J) * fine.size[2] + 2 * K];
+				}
+			}
+		}
+	}
+
+	size_t const iterations = (_method == "multigrid") ? multigrid(u, rhs) : conjugate_gradients(u, rhs);
+
+	_solves++;
+	_iterations += iterations;
+	_max_solve_iterations = std::max(_max_solve_iterations, iterations);
+	std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - clock_start;
+	_solve_seconds += elapsed_seconds.count();
+	return iterations;
+}
+
+/*
+BiCGSTABSolver
+*/
+
+template <typename M>
+BiCGSTABSolver<M>::BiCGSTABSolver(ConfFileData& cf)
+	: _preconditioned_direction(cf, "bicgstab_direction"),
+	_preconditioned_step(cf, "bicgstab_step")
+{
+	_tolerance = cf._linear_solver_tolerance;
+	_max_iterations = cf._linear_solver_max_iterations;
+	_deterministic = cf._deterministic_reductions;
+	_laplacian_diagonal = _preconditioned_direction.stability_weight();
+
+	size_t const mesh_size = _preconditioned_direction.size();
+	_residual.resize(mesh_size, 0.0);
+	_shadow_residual.resize(mesh_size, 0.0);
+	_direction.resize(mesh_size, 0.0);
+	_step.resize(mesh_size, 0.0);
+	_product.resize(mesh_size, 0.0);
+	_step_product.resize(mesh_size, 0.0);
+}
+
+template <typename M>
+size_t BiCGSTABSolver<M>::iterations() const
+{
+	return _iterations;
+}
+template <typename M>
+std::string BiCGSTABSolver<M>::statistics() const
+{
+	return solver_statistics(_solves, _iterations, _max_solve_iterations, _unconverged_solves, _solve_seconds);
+}
+
+template <typename M>
+void BiCGSTABSolver<M>::apply(M const& u, std::vector<double>& product) const
+{
+	size_t const mesh_size = u.size();
+#pragma omp parallel for
+	for (size_t index = 0; index < mesh_size; index++)
+	{
+		if (u.is_on_boundary(index))
+		{
+			product[index] = 0.0;
+		}
+		else
+		{
+			product[index] = (*_inverse_diffusivity)[index] * u[index] - _dt * u.laplacian(index);
+		}
+	}
+}
+
+template <typename M>
+void BiCGSTABSolver<M>::precondition(std::vector<double> const& residual, M& preconditioned) const
+{
+	size_t const mesh_size = residual.size();
+#pragma omp parallel for
+	for (size_t index = 0; index < mesh_size; index++)
+	{
+		preconditioned[index] = preconditioned.is_on_boundary(index) ? 0.0
+			: residual[index] / ((*_inverse_diffusivity)[index] + _dt * _laplacian_diagonal);
+	}
+}
+
+template <typename M>
+double BiCGSTABSolver<M>::dot(std::vector<double> const& a, std::vector<double> const& b) const
+{
+	return parallel_sum(a.size(), _deterministic, [&](size_t const index)
+	{
+		return a[index] * b[index];
+	});
+}
+
+template <typename M>
+size_t BiCGSTABSolver<M>::solve(M& u, std::vector<double> const& inverse_diffusivity, std::vector<double> const& rhs,
+	double const dt)
+{
+	auto clock_start = std::chrono::steady_clock::now();
+	_dt = dt;
+	_inverse_diffusivity = &inverse_diffusivity;
+	size_t const mesh_size = u.size();
+
+	// residual at interior points only; solves stop once it is reduced by linear_solver_tolerance
+	apply(u, _product);
+#pragma omp parallel for
+	for (size_t index = 0; index < mesh_size; index++)
+	{
+		_residual[index] = u.is_on_boundary(index) ? 0.0 : rhs[index] - _product[index];
+		_shadow_residual[index] = _residual[index];
+		_direction[index] = 0.0;
+		_product[index] = 0.0;
+	}
+
+	size_t iterations = 0;
+	double const threshold = _tolerance * std::sqrt(dot(_residual, _residual));
+	bool converged = (threshold == 0.0);
+	double rho = 1.0;
+	double alpha = 1.0;
+	double omega = 1.0;
+	while (not converged and iterations < _max_iterations)
+	{
+		iterations++;
+		double const new_rho = dot(_shadow_residual, _residual);
+		double const beta = (new_rho / rho) * (alpha / omega);
+		rho = new_rho;
+
+		// step along the preconditioned search direction
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			_direction[index] = _residual[index] + beta * (_direction[index] - omega * _product[index]);
+		}
+		precondition(_direction, _preconditioned_direction);
+		apply(_preconditioned_direction, _product);
+		alpha = rho / dot(_shadow_residual, _product);
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			_step[index] = _residual[index] - alpha * _product[index];
+		}
+		if (std::sqrt(dot(_step, _step)) <= threshold)
+		{
+#pragma omp parallel for
+			for (size_t index = 0; index < mesh_size; index++)
+			{
+				u[index] += alpha * _preconditioned_direction[index];
+			}
+			converged = true;
+			break;
+		}
+
+		// stabilising step, minimising the residual
+		precondition(_step, _preconditioned_step);
+		apply(_preconditioned_step, _step_product);
+		omega = dot(_step_product, _step) / dot(_step_product, _step_product);
+#pragma omp parallel for
+		for (size_t index = 0; index < mesh_size; index++)
+		{
+			u[index] += alpha * _preconditioned_direction[index] + omega * _preconditioned_step[index];
+			_residual[index] = _step[index] - omega * _step_product[index];
+		}
+		converged = std::sqrt(dot(_residual, _residual)) <= threshold;
+	}
+
+	_solves++;
+	_iterations += iterations;
+	_max_solve_iterations = std::max(_max_solve_iterations, iterations);
+	if (not converged)
+	{
+		_unconverged_solves++;
+	}
+	std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - clock_start;
+	_solve_seconds += elapsed_seconds.count();
+	return iterations;
+}
+
+// to keep the linker happy, need to instantiate concrete versions of the template class
+template class BiCGSTABSolver<SphereMesh>;
+template class BiCGSTABSolver<CylinderMesh>;
+template class BiCGSTABSolver<CuboidMesh>;
@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "ConfFileData.h"
+#include "Mesh.h"
+
+/*
+Matrix-free solvers for implicit (backward Euler) timesteps.
+
+Dividing the equation for each interior point by its thermal diffusivity D gives
+	u / D - dt L u = b,
+where L is the Laplace operator of CuboidMesh, applied with the boundary values of u held fixed. This system is
+symmetric positive definite (in an inner product where points on the mid-planes of a symmetry reduced cuboid
+count for the fraction of their cell inside the solved part), so it is solved with conjugate gradients,
+preconditioned either by the diagonal ("pcg") or by a geometric multigrid V-cycle ("mgcg"), or with multigrid
+V-cycles on their own ("multigrid").
+*/
+
+// One level of the multigrid hierarchy; level 0 is the mesh of settings.conf and each level after it has
+// twice the spacing of the one before
+struct MultigridLevel
+{
+	ConfFileData conf_file_data;
+	// correction to the solution, with zero boundary values
+	CuboidMesh correction;
+	std::vector<double> inverse_diffusivity;
+	std::vector<double> rhs;
+	std::vector<double> product;
+	// weight of each point in the inner product
+	std::vector<double> weight;
+	size_t size[3];
+	double laplacian_diagonal;
+
+	MultigridLevel(ConfFileData const& conf_file_data);
+};
+
+class CuboidLinearSolver
+{
+private:
+	// Settings
+	std::string _method;
+	double _tolerance;
+	size_t _max_iterations;
+	double _dt = 0.0;
+	// add up dot products in fixed blocks (deterministic_reductions=true, see Reductions.h)
+	bool _deterministic;
+
+	// Multigrid levels (only level 0 for "pcg") and vectors for conjugate gradients
+	std::vector<MultigridLevel> _levels;
+	CuboidMesh _direction;
+	std::vector<double> _residual;
+	std::vector<double> _preconditioned;
+	std::vector<double> _product;
+
+	// Statistics
+	size_t _solves = 0;
+	size_t _iterations = 0;
+	size_t _max_solve_iterations = 0;
+	size_t _unconverged_solves = 0;
+	double _solve_seconds = 0.0;
+
+	// product = (1 / D - dt L) u at interior points and 0 on the boundary
+	void apply(MultigridLevel const& level, CuboidMesh const& u, std::vector<double>& product) const;
+	double dot(MultigridLevel const& level, std::vector<double> const& a, std::vector<double> const& b) const;
+
+	// Multigrid components, acting on the corrections of each level
+	void smooth(MultigridLevel& level, size_t const sweeps);
+	void restrict_residual(MultigridLevel const& fine, MultigridLevel& coarse) const;
+	void prolong_correction(MultigridLevel const& coarse, MultigridLevel& fine) const;
+	void v_cycle(size_t const l);
+
+	// preconditioned = M^-1 residual
+	void precondition();
+
+	size_t conjugate_gradients(CuboidMesh& u, std::vector<double> const& rhs);
+	size_t multigrid(CuboidMesh& u, std::vector<double> const& rhs);
+
+public:
+	CuboidLinearSolver(ConfFileData& conf_file_data);
+
+	// Solve u / D - dt L u = rhs for the interior values of u, which holds the initial guess and the boundary
+	// values; returns the number of iterations
+	size_t solve(CuboidMesh& u, std::vector<double> const& inverse_diffusivity, std::vector<double> const& rhs,
+		double const dt);
+
+	size_t number_of_levels() const;
+	size_t iterations() const;
+	// Summary of solves so far (number, iterations and time taken)
+	std::string statistics() const;
+
+	// Smoothing sweeps of damped Jacobi before and after each coarse correction, and on the coarsest level
+	static size_t const SMOOTHING_SWEEPS = 2;
+	static size_t const COARSEST_SWEEPS = 20;
+};
+
+/*
+Stabilised biconjugate gradients (BiCGSTAB) for the same equations on any mesh. The Laplace operators of the
+sphere and cylinder aren't symmetric, so conjugate gradients can't be used for them. The preconditioner is the
+diagonal of the equations, with the diagonal of the Laplace operator approximated by the stability weight of the
+mesh.
+*/
+template <typename M>
+class BiCGSTABSolver
+{
+private:
+	// Settings
+	double _tolerance;
+	size_t _max_iterations;
+	double _dt = 0.0;
+	// add up dot products in fixed blocks (deterministic_reductions=true, see Reductions.h)
+	bool _deterministic;
+	double _laplacian_diagonal;
+
+	// Vectors; the preconditioned search directions need the mesh's Laplace operator
+	std::vector<double> const* _inverse_diffusivity = nullptr;
+	M _preconditioned_direction;
+	M _preconditioned_step;
+	std::vector<double> _residual;
+	std::vector<double> _shadow_residual;
+	std::vector<double> _direction;
+	std::vector<double> _step;
+	std::vector<double> _product;
+	std::vector<double> _step_product;
+
+	// Statistics
+	size_t _solves = 0;
+	size_t _iterations = 0;
+	size_t _max_solve_iterations = 0;
+	size_t _unconverged_solves = 0;
+	double _solve_seconds = 0.0;
+
+	// product = (1 / D - dt L) u at interior points and 0 on the boundary
+	void apply(M const& u, std::vector<double>& product) const;
+	// preconditioned = residual / diagonal at interior points and 0 on the boundary
+	void precondition(std::vector<double> const& residual, M& preconditioned) const;
+	double dot(std::vector<double> const& a, std::vector<double> const& b) const;
+
+public:
+	BiCGSTABSolver(ConfFileData& conf_file_data);
+
+	// Solve u / D - dt L u = rhs for the interior values of u, which holds the initial guess and the boundary
+	// values; returns the number of iterations
+	size_t solve(M& u, std::vector<double> const& inverse_diffusivity, std::vector<double> const& rhs,
+		double const dt);
+
+	size_t iterations() const;
+	// Summary of solves so far (number, iterations and time taken)
+	std::string statistics() const;
+};
@@ -1,18 +1,49 @@
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <stdexcept>
 #include "Log.h"
 
+static bool batch_setting = false;
+// number of BatchScope objects in existence
+static std::atomic<size_t> batch_scopes{ 0 };
+
+static bool batch()
+{
+	return batch_setting or batch_scopes > 0;
+}
+
+void Log::set_batch_mode(bool batch_mode)
+{
+	batch_setting = batch_mode;
+}
+
+Log::BatchScope::BatchScope()
+{
+	batch_scopes++;
+}
+
+Log::BatchScope::~BatchScope()
+{
+	batch_scopes--;
+}
 
 void Log::write(std::ofstream& log_file, std::string msg)
 {
 	log_file << msg;
-	std::cout << msg;
+	if (not batch())
+	{
+		std::cout << msg;
+	}
 }
 
 void Log::write_to_console(std::string console_msg)
 {
-	std::cout << console_msg;
+	if (not batch())
+	{
+		std::cout << console_msg;
+	}
 }
 void Log::write_to_console_and_quit(std::string console_msg)
 {
@@ -30,6 +61,10 @@ void Log::write_to_log_file(std::ofstream& log_file, std::string log_msg)
 void Log::error_write(std::ofstream& log_file, std::string err_msg)
 {
 	log_file << "[ERROR]: " << err_msg;
+	if (batch())
+	{
+		throw std::runtime_error(err_msg);
+	}
 	std::cout << "[ERROR]: " << err_msg;
 	std::cout << "Press ENTER to exit.\n";
 	std::cin.get();
@@ -9,4 +9,19 @@ namespace Log
 	void write_to_console_and_quit(std::string console_msg);
 	void write_to_log_file(std::ofstream& log_file, std::string log_msg);
 	void error_write(std::ofstream& log_file, std::string err_msg);
+
+	// In batch mode (the server, see Server.h) nothing is written to the console, and errors throw
+	// std::runtime_error instead of waiting for ENTER and exiting
+	void set_batch_mode(bool batch_mode);
+
+	// Batch mode for as long as the object exists, whatever set_batch_mode was given (for sessions, see
+	// SolverSession.h, which can overlap and must leave the host program's mode as it was)
+	class BatchScope
+	{
+	public:
+		BatchScope();
+		~BatchScope();
+		BatchScope(BatchScope const&) = delete;
+		BatchScope& operator=(BatchScope const&) = delete;
+	};
 }
\ No newline at end of file
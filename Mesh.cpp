@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <fstream>
 #include <cmath>
+#include <filesystem>
 #include <iomanip> // for std::setprecision
 
 Mesh::Mesh(size_t const mesh_size, std::string const& mesh_name)
@@ -35,10 +36,30 @@ size_t Mesh::size() const
 {
 	return _mesh_size;
 }
+std::vector<double> const& Mesh::values() const
+{
+	return _mesh_data;
+}
+std::vector<std::string> const& Mesh::filenames() const
+{
+	return _filenames;
+}
 void Mesh::fill(double const value)
 {
 	std::fill(_mesh_data.begin(), _mesh_data.end(), value);
 }
+void Mesh::swap_values(Mesh& mesh)
+{
+	_mesh_data.swap(mesh._mesh_data);
+}
+void Mesh::copy_values(Mesh const& mesh)
+{
+	_mesh_data = mesh._mesh_data;
+}
+std::string Mesh::sibling_name(std::string const& mesh_name) const
+{
+	return std::filesystem::path(_mesh_name).replace_filename(mesh_name).string();
+}
 double Mesh::laplacian(size_t const index) const
 {
 	if (index)
@@ -47,28 +68,512 @@ double Mesh::laplacian(size_t const index) const
 	}
 	return 0.0;
 }
-bool Mesh::nearly_equal(Mesh& other)
+double Mesh::stability_weight() const
+{
+	return 0.0;
+}
+
+/*
+Radial meshes
+The radial points of SphereMesh and CylinderMesh are either equally spaced or graded towards the surface
+(r = R), where the steepest temperature gradients are.
+*/
+
+// Radial coordinates (in metres) of meshsize points between the centre and radius (in microns)
+static std::vector<double> radial_coordinates(double const radius, size_t const meshsize,
+	std::string const& grading, double const grading_factor)
+{
+	double const R = radius / 1000000;
+	std::vector<double> r(meshsize);
+	for (size_t i = 0; i < meshsize; i++)
+	{
+		double const xi = static_cast<double>(i) / (meshsize - 1);
+		if (grading == "geometric" and grading_factor != 1.0)
+		{
+			// spacing shrinks by grading_factor from each point to the next
+			r[i] = R * (1 - std::pow(grading_factor, i)) / (1 - std::pow(grading_factor, meshsize - 1));
+		}
+		else if (grading == "tanh")
+		{
+			// spacing shrinks smoothly towards the surface, more quickly for larger grading_factor
+			r[i] = R * std::tanh(grading_factor * xi) / std::tanh(grading_factor);
+		}
+		else
+		{
+			r[i] = R * xi;
+		}
+	}
+	r[meshsize - 1] = R;
+	return r;
+}
+
+/*
+Coefficients of the radial part of the Laplace operator, d^2u/dr^2 + (m/r) du/dr, where m = 2 for a sphere
+and m = 1 for a cylinder, so that at radial index i it is
+	plus[i] * (u[i + 1] - u[i]) + minus[i] * (u[i - 1] - u[i]).
+Equally spaced meshes use the usual finite difference stencil; graded meshes use a finite volume stencil,
+with cell faces halfway between points, which stays accurate when neighbouring spacings differ.
+Both reduce to 2 (m + 1) (u[1] - u[0]) / dr^2 at the centre.
+*/
+static void radial_laplacian_coefficients(std::vector<double> const& r, double const m, bool const graded,
+	std::vector<double>& plus, std::vector<double>& minus)
+{
+	size_t const meshsize = r.size();
+	plus.assign(meshsize, 0.0);
+	minus.assign(meshsize, 0.0);
+
+	if (not graded)
+	{
+		double const dr = r[1] - r[0];
+		plus[0] = 2 * (m + 1) / (dr * dr);
+		for (size_t i = 1; i < meshsize - 1; i++)
+		{
+			plus[i] = (1 + m / i) / (dr * dr);
+			minus[i] = 1 / (dr * dr);
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < meshsize - 1; i++)
+	{
+		double const face_plus = (r[i] + r[i + 1]) / 2;
+		double const face_minus = (i == 0) ? 0.0 : (r[i - 1] + r[i]) / 2;
+		double const volume = (std::pow(face_plus, m + 1) - std::pow(face_minus, m + 1)) / (m + 1);
+
+		plus[i] = std::pow(face_plus, m) / ((r[i + 1] - r[i]) * volume);
+		if (i > 0)
+		{
+			minus[i] = std::pow(face_minus, m) / ((r[i] - r[i - 1]) * volume);
+		}
+	}
+}
+
+/*
+Symmetry reduction
+With uniform heating the cylinder is symmetric about its mid-plane and the cuboid about each of its three
+mid-planes, so with symmetry_reduction=true only the points up to and including each mid-plane are solved.
+The mid-plane has zero flux through it, so the point beyond it is the mirror image of the point before it.
+Output covers the full domain, with each point taking the value of its mirror image in the solved part.
+*/
+
+// Number of points solved along an axis with meshsize points (an odd number if symmetric)
+static size_t solved_meshsize(size_t const meshsize, bool const symmetric)
+{
+	return symmetric ? meshsize / 2 + 1 : meshsize;
+}
+
+// Index of the solved point holding the value of point i along an axis with full_meshsize points
+static size_t folded_index(size_t const i, size_t const full_meshsize, size_t const meshsize)
+{
+	return (i < meshsize) ? i : full_meshsize - 1 - i;
+}
+
+// Index of the next point along an axis, mirrored back across the mid-plane at the end of a reduced axis
+static size_t next_index(size_t const i, size_t const meshsize)
+{
+	return (i + 1 < meshsize) ? i + 1 : i - 1;
+}
+
+/*
+Fourth-order stencils (spatial_order=4)
+Along each axis the second derivative uses the five-point stencil (-1, 16, -30, 16, -1) / 12h^2, and the
+(m/r) du/dr term of the radial axes the four-point first derivative (1, -8, 0, 8, -1) / 12h. Next to a boundary
+point, where the five-point stencils would reach outside the mesh, they are replaced by one-sided stencils of
+the same order, (10, -15, -4, 14, -6, 1) / 12h^2 from the boundary point inwards and (-3, -10, 18, -6, 1) / 12h
+from the point before. Points beyond the centre (r = 0) or beyond a mirrored mid-plane are folded back onto their
+mirror images, and at the centre the radial part is (m + 1) d^2u/dr^2, as in the second-order stencil.
+*/
+
+enum class AxisEnd { boundary, centre, mirror };
+
+// Stencil along an axis of meshsize points, spacing h (in metres) and m = 0 for a Cartesian axis, with
+// the given kinds of first and last point; rows of boundary points are left empty
+static AxisStencil fourth_order_stencil(size_t const meshsize, double const h, double const m,
+	AxisEnd const lower, AxisEnd const upper)
+{
+	AxisStencil stencil;
+	stencil.points.resize(meshsize);
+	stencil.weights.resize(meshsize);
+
+	long const last = static_cast<long>(meshsize) - 1;
+	for (long i = 0; i <= last; i++)
+	{
+		auto& points = stencil.points[i];
+		auto& weights = stencil.weights[i];
+		points.fill(i);
+		weights.fill(0.0);
+		if ((i == 0 and lower == AxisEnd::boundary) or (i == last and upper == AxisEnd::boundary))
+		{
+			continue;
+		}
+
+		// add weight to the point at offset from i, folding it back across the centre or the mid-plane
+		size_t used = 0;
+		auto add = [&](long const offset, double const weight)
+		{
+			long j = i + offset;
+			j = (j < 0) ? -j : j;
+			j = (j > last) ? 2 * last - j : j;
+			size_t e = 0;
+			while (e < used and points[e] != static_cast<size_t>(j))
+			{
+				e++;
+			}
+			if (e == used)
+			{
+				points[used++] = j;
+			}
+			weights[e] += weight;
+		};
+
+		double const second[5] = { -1.0, 16.0, -30.0, 16.0, -1.0 };
+		double const second_one_sided[6] = { 10.0, -15.0, -4.0, 14.0, -6.0, 1.0 };
+		double const first[5] = { 1.0, -8.0, 0.0, 8.0, -1.0 };
+		double const first_one_sided[5] = { -3.0, -10.0, 18.0, -6.0, 1.0 };
+
+		if (i == 0 and lower == AxisEnd::centre)
+		{
+			for (long o = -2; o <= 2; o++)
+			{
+				add(o, (m + 1) * second[o + 2] / (12 * h * h));
+			}
+			continue;
+		}
+
+		bool const after_boundary = (i == 1 and lower == AxisEnd::boundary);
+		bool const before_boundary = (i == last - 1 and upper == AxisEnd::boundary);
+		for (long o = 0; o < 6; o++)
+		{
+			if (after_boundary)
+			{
+				add(o - 1, second_one_sided[o] / (12 * h * h));
+			}
+			else if (before_boundary)
+			{
+				add(1 - o, second_one_sided[o] / (12 * h * h));
+			}
+			else if (o < 5)
+			{
+				add(o - 2, second[o] / (12 * h * h));
+			}
+		}
+		if (m > 0)
+		{
+			double const r = i * h;
+			for (long o = 0; o < 5; o++)
+			{
+				if (before_boundary)
+				{
+					add(1 - o, -m * first_one_sided[o] / (12 * h * r));
+				}
+				else
+				{
+					add(o - 2, m * first[o] / (12 * h * r));
+				}
+			}
+		}
+	}
+
+	// estimate the spectral radius by power iteration, starting from the most oscillatory vector
+	std::vector<double> v(meshsize), w(meshsize);
+	for (size_t i = 0; i < meshsize; i++)
+	{
+		v[i] = (i % 2) ? 1.0 : -1.0;
+	}
+	for (size_t iteration = 0; iteration < 200; iteration++)
+	{
+		double norm = 0.0;
+		for (size_t i = 0; i < meshsize; i++)
+		{
+			w[i] = 0.0;
+			for (size_t e = 0; e < 6; e++)
+			{
+				w[i] += stencil.weights[i][e] * v[stencil.points[i][e]];
+			}
+			norm += w[i] * w[i];
+		}
+		double old_norm = 0.0;
+		for (size_t i = 0; i < meshsize; i++)
+		{
+			old_norm += v[i] * v[i];
+		}
+		// the growth factor oscillates if the largest eigenvalues are complex, so take the largest once settled
+		if (iteration >= 100)
+		{
+			stencil.spectral_radius = std::max(stencil.spectral_radius, std::sqrt(norm / old_norm));
+		}
+		for (size_t i = 0; i < meshsize; i++)
+		{
+			v[i] = w[i] / std::sqrt(norm);
+		}
+	}
+	return stencil;
+}
+
+// Part of the Laplace operator from a stencil at point i along its axis, where the axis starts at base in data
+// and consecutive points along it are stride apart
+static double stencil_sum(AxisStencil const& stencil, size_t const i, std::vector<double> const& data,
+	size_t const base, size_t const stride)
+{
+	double sum = 0.0;
+	for (size_t e = 0; e < 6; e++)
+	{
+		sum += stencil.weights[i][e] * data[base + stencil.points[i][e] * stride];
+	}
+	return sum;
+}
+
+/*
+Geometries
+*/
+
+/*
+Point volumes
+Each point stands for the cell between the faces halfway to its neighbours, so the volumes are those of spherical
+or cylindrical shells along the radius and of slabs along the other axes, halved at the surface. A point before a
+mid-plane also stands for its mirror image, and a point on it for its whole cell.
+*/
+
+// Volume per unit height (cylinder, m = 1) or volume (sphere, m = 2) of the shell each radial point stands for
+static std::vector<double> radial_volumes(std::vector<double> const& r, double const m)
+{
+	size_t const meshsize = r.size();
+	std::vector<double> volumes(meshsize);
+	double const shell_constant = (m == 2) ? 4 * M_PI / 3 : M_PI;
+	for (size_t i = 0; i < meshsize; i++)
+	{
+		double const face_plus = (i == meshsize - 1) ? r[i] : (r[i] + r[i + 1]) / 2;
+		double const face_minus = (i == 0) ? 0.0 : (r[i - 1] + r[i]) / 2;
+		volumes[i] = shell_constant * (std::pow(face_plus, m + 1) - std::pow(face_minus, m + 1));
+	}
+	return volumes;
+}
+
+// Length (in metres) each solved point along an axis of equally spaced points stands for
+static std::vector<double> axis_lengths(size_t const full_meshsize, size_t const meshsize, double const spacing)
+{
+	std::vector<double> lengths(meshsize, spacing);
+	lengths[0] = spacing / 2;
+	if (meshsize == full_meshsize)
+	{
+		lengths[meshsize - 1] = spacing / 2;
+	}
+	else
+	{
+		for (size_t i = 0; i < meshsize - 1; i++)
+		{
+			lengths[i] *= 2;
+		}
+	}
+	return lengths;
+}
+
+// Index of the solved point at the middle of an axis (or the nearest below it, for an even full_meshsize)
+static size_t middle_index(size_t const full_meshsize, size_t const meshsize)
+{
+	return std::min((full_meshsize - 1) / 2, meshsize - 1);
+}
+
+/*
+Interpolation
+A position in the particle is interpolated linearly along each axis between the points either side of it, and the
+weight of each point is the product of its weights along the axes. Along a reduced axis (symmetry_reduction=true)
+the points beyond the mid-plane are folded back onto their mirror images.
+*/
+
+// Points either side of coordinate along an axis with points at coordinates, and the weight of each (none outside)
+static std::vector<std::pair<size_t, double>> axis_interpolation(std::vector<double> const& coordinates,
+	double const coordinate)
+{
+	// (the last point may differ from the end of the axis by rounding)
+	double const tolerance = 1e-9 * (coordinates.back() - coordinates.front());
+	if (coordinate < coordinates.front() - tolerance or coordinate > coordinates.back() + tolerance)
+	{
+		return {};
+	}
+	size_t const upper = std::clamp<size_t>(std::upper_bound(coordinates.begin(), coordinates.end(), coordinate)
+		- coordinates.begin(), 1, coordinates.size() - 1);
+	size_t const lower = upper - 1;
+	double const weight = std::clamp((coordinate - coordinates[lower]) / (coordinates[upper] - coordinates[lower]),
+		0.0, 1.0);
+	return { { lower, 1 - weight }, { upper, weight } };
+}
+
+// Interpolation along an axis of full_meshsize equally spaced points, of which meshsize are solved
+static std::vector<std::pair<size_t, double>> equally_spaced_interpolation(size_t const full_meshsize,
+	size_t const meshsize, double const spacing, double const coordinate)
+{
+	std::vector<double> coordinates(full_meshsize);
+	for (size_t i = 0; i < full_meshsize; i++)
+	{
+		coordinates[i] = i * spacing;
+	}
+	std::vector<std::pair<size_t, double>> weights = axis_interpolation(coordinates, coordinate);
+	for (auto& weight : weights)
+	{
+		weight.first = folded_index(weight.first, full_meshsize, meshsize);
+	}
+	return weights;
+}
+
+void MeshGeometry::list_points()
+{
+	interior_points.clear();
+	boundary_points.clear();
+	for (size_t index = 0; index < on_boundary.size(); index++)
+	{
+		(on_boundary[index] ? boundary_points : interior_points).push_back(index);
+	}
+}
+
+SphereGeometry::SphereGeometry(ConfFileData const& conf_file_data)
+{
+	radius = conf_file_data._sphere_radius;
+	radial_meshsize = conf_file_data._sphere_radial_meshsize;
+	r = radial_coordinates(radius, radial_meshsize, conf_file_data._radial_grading, conf_file_data._radial_grading_factor);
+	radial_laplacian_coefficients(r, 2, conf_file_data._radial_grading != "uniform", radial_plus, radial_minus);
+	fourth_order = (conf_file_data._spatial_order == 4);
+	if (fourth_order)
+	{
+		radial_stencil = fourth_order_stencil(radial_meshsize, r[1] - r[0], 2, AxisEnd::centre, AxisEnd::boundary);
+	}
+
+	at_centre.resize(radial_meshsize, false);
+	on_boundary.resize(radial_meshsize, false);
+
+	// determine centre points
+	at_centre[0] = true;
+
+	// determine boundary points
+	on_boundary[radial_meshsize - 1] = true;
+	list_points();
+
+	volumes = radial_volumes(r, 2);
+	centre_point = 0;
+}
+
+CylinderGeometry::CylinderGeometry(ConfFileData const& conf_file_data)
 {
-	if (_mesh_size != other.size())
+	radius = conf_file_data._cylinder_radius;
+	height = conf_file_data._cylinder_height;
+	radial_meshsize = conf_file_data._cylinder_radial_meshsize;
+	full_height_meshsize = conf_file_data._cylinder_height_meshsize;
+	height_meshsize = solved_meshsize(full_height_meshsize, conf_file_data._symmetry_reduction);
+	r = radial_coordinates(radius, radial_meshsize, conf_file_data._radial_grading, conf_file_data._radial_grading_factor);
+	radial_laplacian_coefficients(r, 1, conf_file_data._radial_grading != "uniform", radial_plus, radial_minus);
+	dz = height / (1000000 * (full_height_meshsize - 1));
+	fourth_order = (conf_file_data._spatial_order == 4);
+	if (fourth_order)
 	{
-		return false;
+		radial_stencil = fourth_order_stencil(radial_meshsize, r[1] - r[0], 1, AxisEnd::centre, AxisEnd::boundary);
+		axial_stencil = fourth_order_stencil(height_meshsize, dz, 0, AxisEnd::boundary,
+			(height_meshsize == full_height_meshsize) ? AxisEnd::boundary : AxisEnd::mirror);
 	}
 
-	double sum_of_square_diffs = 0.0;
-	for (size_t n = 0; n < _mesh_size; n++)
+	at_centre.resize(radial_meshsize * height_meshsize, false);
+	on_boundary.resize(radial_meshsize * height_meshsize, false);
+
+	// define centre points
+	for (size_t j = 0; j < height_meshsize; j++)
+	{
+		at_centre[j] = true;
+	}
+
+	// define boundary points
+	for (size_t i = 0; i < radial_meshsize; i++)
 	{
-		sum_of_square_diffs += ((*this)[n] - other[n]) * ((*this)[n] - other[n]);
+		// bottom of cylinder
+		on_boundary[i * height_meshsize] = true;
+		// top of cylinder, unless only the lower half is solved
+		if (height_meshsize == full_height_meshsize)
+		{
+			on_boundary[i * height_meshsize + height_meshsize - 1] = true;
+		}
 	}
-	return (sum_of_square_diffs < std::pow(10, -12));
+	for (size_t j = 0; j < height_meshsize; j++)
+	{
+		// curved edge of cylinder
+		on_boundary[(radial_meshsize - 1) * height_meshsize + j] = true;
+	}
+	list_points();
+
+	std::vector<double> const shell_areas = radial_volumes(r, 1);
+	std::vector<double> const heights = axis_lengths(full_height_meshsize, height_meshsize, dz);
+	volumes.resize(radial_meshsize * height_meshsize);
+	for (size_t i = 0; i < radial_meshsize; i++)
+	{
+		for (size_t j = 0; j < height_meshsize; j++)
+		{
+			volumes[i * height_meshsize + j] = shell_areas[i] * heights[j];
+		}
+	}
+	centre_point = middle_index(full_height_meshsize, height_meshsize);
 }
-bool Mesh::is_nan() const
+
+CuboidGeometry::CuboidGeometry(ConfFileData const& conf_file_data)
 {
-	// check all points in mesh for NaN
-	for (auto& point : _mesh_data)
+	x_length = conf_file_data._x_length;
+	y_length = conf_file_data._y_length;
+	z_length = conf_file_data._z_length;
+	full_x_meshsize = conf_file_data._x_meshsize;
+	full_y_meshsize = conf_file_data._y_meshsize;
+	full_z_meshsize = conf_file_data._z_meshsize;
+	x_meshsize = solved_meshsize(full_x_meshsize, conf_file_data._symmetry_reduction);
+	y_meshsize = solved_meshsize(full_y_meshsize, conf_file_data._symmetry_reduction);
+	z_meshsize = solved_meshsize(full_z_meshsize, conf_file_data._symmetry_reduction);
+
+	// dx, dy, dz are in metres rather than microns
+	dx = x_length / (1000000 * (full_x_meshsize - 1));
+	dy = y_length / (1000000 * (full_y_meshsize - 1));
+	dz = z_length / (1000000 * (full_z_meshsize - 1));
+
+	fourth_order = (conf_file_data._spatial_order == 4);
+	if (fourth_order)
+	{
+		size_t const meshsizes[3] = { x_meshsize, y_meshsize, z_meshsize };
+		size_t const full_meshsizes[3] = { full_x_meshsize, full_y_meshsize, full_z_meshsize };
+		double const spacings[3] = { dx, dy, dz };
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			stencils[axis] = fourth_order_stencil(meshsizes[axis], spacings[axis], 0, AxisEnd::boundary,
+				(meshsizes[axis] != full_meshsizes[axis]) ? AxisEnd::mirror : AxisEnd::boundary);
+		}
+	}
+
+	// mark boundary points
+	on_boundary.resize(x_meshsize * y_meshsize * z_meshsize, false);
+	for (size_t i = 0; i < x_meshsize; i++)
+	{
+		for (size_t j = 0; j < y_meshsize; j++)
+		{
+			for (size_t k = 0; k < z_meshsize; k++)
+			{
+				if (i == 0 or j == 0 or k == 0 or i == full_x_meshsize - 1 or j == full_y_meshsize - 1
+					or k == full_z_meshsize - 1)
+				{
+					on_boundary[i * y_meshsize * z_meshsize + j * z_meshsize + k] = true;
+				}
+			}
+		}
+	}
+	list_points();
+
+	std::vector<double> const x_lengths = axis_lengths(full_x_meshsize, x_meshsize, dx);
+	std::vector<double> const y_lengths = axis_lengths(full_y_meshsize, y_meshsize, dy);
+	std::vector<double> const z_lengths = axis_lengths(full_z_meshsize, z_meshsize, dz);
+	volumes.resize(x_meshsize * y_meshsize * z_meshsize);
+	for (size_t i = 0; i < x_meshsize; i++)
 	{
-		if (std::isnan(point)) return true;
+		for (size_t j = 0; j < y_meshsize; j++)
+		{
+			for (size_t k = 0; k < z_meshsize; k++)
+			{
+				volumes[i * y_meshsize * z_meshsize + j * z_meshsize + k] = x_lengths[i] * y_lengths[j] * z_lengths[k];
+			}
+		}
 	}
-	return false;
+	centre_point = middle_index(full_x_meshsize, x_meshsize) * y_meshsize * z_meshsize
+		+ middle_index(full_y_meshsize, y_meshsize) * z_meshsize + middle_index(full_z_meshsize, z_meshsize);
 }
 
 /*
@@ -81,62 +586,108 @@ double& SphereMesh::operator()(size_t const i)
 }
 bool SphereMesh::is_at_centre(size_t const i) const
 {
-	return _at_centre[i];
+	return _geometry->at_centre[i];
 }
 bool SphereMesh::is_on_boundary(size_t const i) const
 {
-	return _on_boundary[i];
+	return _geometry->on_boundary[i];
+}
+std::vector<size_t> const& SphereMesh::interior_points() const
+{
+	return _geometry->interior_points;
+}
+std::vector<double> const& SphereMesh::point_volumes() const
+{
+	return _geometry->volumes;
+}
+size_t SphereMesh::centre_point() const
+{
+	return _geometry->centre_point;
+}
+std::vector<std::pair<size_t, double>> SphereMesh::interpolation_weights(std::vector<double> const& position) const
+{
+	if (position.size() != 1)
+	{
+		return {};
+	}
+	return axis_interpolation(_geometry->r, position[0] / 1000000);
+}
+std::vector<size_t> const& SphereMesh::boundary_points() const
+{
+	return _geometry->boundary_points;
+}
+size_t SphereMesh::meshsize(size_t const axis) const
+{
+	if (axis)
+	{
+		// gcc complains if axis isn't used
+	}
+	return _geometry->radial_meshsize;
 }
 
 SphereMesh::SphereMesh(ConfFileData& conf_file_data, std::string const& mesh_name)
-	: Mesh(conf_file_data._sphere_radial_meshsize, mesh_name)
+	: Mesh(conf_file_data._sphere_radial_meshsize, conf_file_data.output_path(mesh_name))
 {
-	_radius = conf_file_data._sphere_radius;
-	_radial_meshsize = conf_file_data._sphere_radial_meshsize;
-	_dr = _radius / (1000000 * (_radial_meshsize - 1));
-
-	_at_centre.resize(_mesh_size, false);
-	_on_boundary.resize(_mesh_size, false);
-
-	// determine centre points
-	_at_centre[0] = true;
-
-	// determine boundary points
-	_on_boundary[_radial_meshsize - 1] = true;
+	_geometry = std::make_shared<SphereGeometry const>(conf_file_data);
+}
+SphereMesh::SphereMesh(SphereMesh const& mesh, std::string const& mesh_name)
+	: Mesh(mesh._mesh_size, mesh.sibling_name(mesh_name))
+{
+	_geometry = mesh._geometry;
 }
 SphereMesh::SphereMesh(SphereMesh const& mesh)
 	: Mesh(mesh)
 {
-	_radius = mesh._radius;
-	_radial_meshsize = mesh._radial_meshsize;
-	_dr = mesh._dr;
-
-	_at_centre = mesh._at_centre;
-	_on_boundary = mesh._on_boundary;
+	_geometry = mesh._geometry;
 }
 
 double SphereMesh::laplacian(size_t const index) const
 {
+	SphereGeometry const& geometry = *_geometry;
 	if (is_on_boundary(index))
 	{
 		throw std::runtime_error("Laplace operator: invalid index " + std::to_string(index) + '\n');
 	}
 	else
 	{
+		if (geometry.fourth_order)
+		{
+			return stencil_sum(geometry.radial_stencil, index, _mesh_data, 0, 1);
+		}
 		if (is_at_centre(index))
 		{
-			return 6 * (_mesh_data[index + 1] - _mesh_data[index]) / (_dr * _dr);
+			return geometry.radial_plus[index] * (_mesh_data[index + 1] - _mesh_data[index]);
 		}
 		else
 		{
-			return (_mesh_data[index + 1] - 2 * _mesh_data[index] + _mesh_data[index - 1]) / (_dr * _dr)
-				+ 2 * (_mesh_data[index + 1] - _mesh_data[index]) / (index * _dr * _dr);
+			return geometry.radial_plus[index] * (_mesh_data[index + 1] - _mesh_data[index])
+				+ geometry.radial_minus[index] * (_mesh_data[index - 1] - _mesh_data[index]);
 		}
 	}
 }
 
+double SphereMesh::stability_weight() const
+{
+	SphereGeometry const& geometry = *_geometry;
+	if (geometry.fourth_order)
+	{
+		// half the spectral radius, which is the largest diagonal coefficient for the second-order stencil
+		return geometry.radial_stencil.spectral_radius / 2;
+	}
+
+	// largest diagonal coefficient of the Laplace operator
+	double weight = 0.0;
+	for (size_t i = 0; i < geometry.radial_meshsize - 1; i++)
+	{
+		weight = std::max(weight, geometry.radial_plus[i] + geometry.radial_minus[i]);
+	}
+	return weight;
+}
+
 void SphereMesh::setup_files()
 {
+	SphereGeometry const& geometry = *_geometry;
+
 	// create filename
 	std::string filename = _mesh_name + ".csv";
 	_filenames.push_back(filename);
@@ -146,7 +697,7 @@ void SphereMesh::setup_files()
 
 	// write top row
 	output_file << ",Distance from centre (microns)";
-	for (size_t i = 0; i < _radial_meshsize - 1; i++)
+	for (size_t i = 0; i < geometry.radial_meshsize - 1; i++)
 	{
 		output_file << ',';
 	}
@@ -154,17 +705,18 @@ void SphereMesh::setup_files()
 
 	// write second row (containing values of r in microns)
 	output_file << "Time (s),";
-	for (size_t i = 0; i < _radial_meshsize - 1; i++)
+	for (size_t i = 0; i < geometry.radial_meshsize - 1; i++)
 	{
-		output_file << i * _dr * 1000000 << ',';
+		output_file << geometry.r[i] * 1000000 << ',';
 	}
-	output_file << (_radial_meshsize - 1) * _dr * 1000000 << '\n';
+	output_file << geometry.r[geometry.radial_meshsize - 1] * 1000000 << '\n';
 
 	_files_ready = true;
 }
 
 void SphereMesh::write_files(size_t const second_count, size_t sig_figs)
 {
+	size_t const radial_meshsize = _geometry->radial_meshsize;
 	if (_files_ready)
 	{
 		// loop over files
@@ -176,11 +728,11 @@ void SphereMesh::write_files(size_t const second_count, size_t sig_figs)
 
 			// write to file
 			output_file << second_count << ',';
-			for (size_t i = 0; i < _radial_meshsize - 1; i++)
+			for (size_t i = 0; i < radial_meshsize - 1; i++)
 			{
 				output_file << (*this)(i) << ',';
 			}
-			output_file << (*this)(_radial_meshsize - 1) << '\n';
+			output_file << (*this)(radial_meshsize - 1) << '\n';
 		}
 	}
 	else
@@ -195,120 +747,154 @@ CylinderMesh
 
 double& CylinderMesh::operator()(size_t const i, size_t const j)
 {
-	return _mesh_data[i * _height_meshsize + j];
+	return _mesh_data[i * _geometry->height_meshsize + j];
 }
 bool CylinderMesh::is_at_centre(size_t const i, size_t const j) const
 {
-	return _at_centre[i * _height_meshsize + j];
+	return _geometry->at_centre[i * _geometry->height_meshsize + j];
 }
 bool CylinderMesh::is_on_boundary(size_t const n) const
 {
-	return _on_boundary[n];
+	return _geometry->on_boundary[n];
 }
-
-CylinderMesh::CylinderMesh(ConfFileData& conf_file_data, std::string const& mesh_name) 
-	: Mesh(conf_file_data._cylinder_radial_meshsize * conf_file_data._cylinder_height_meshsize, mesh_name)
+std::vector<size_t> const& CylinderMesh::interior_points() const
 {
-	_radius = conf_file_data._cylinder_radius;
-	_height = conf_file_data._cylinder_height;
-	_radial_meshsize = conf_file_data._cylinder_radial_meshsize;
-	_height_meshsize = conf_file_data._cylinder_height_meshsize;
-	_dr = _radius / (1000000 * (_radial_meshsize - 1));
-	_dz = _height / (1000000 * (_height_meshsize - 1));
-
-	_at_centre.resize(_mesh_size, false);
-	_on_boundary.resize(_mesh_size, false);
-
-	// define centre points
-	for (size_t j = 0; j < _height_meshsize; j++)
-	{
-		_at_centre[j] = true;
-	}
-
-	// define boundary points
-	for (size_t i = 0; i < _radial_meshsize; i++)
+	return _geometry->interior_points;
+}
+std::vector<double> const& CylinderMesh::point_volumes() const
+{
+	return _geometry->volumes;
+}
+size_t CylinderMesh::centre_point() const
+{
+	return _geometry->centre_point;
+}
+std::vector<std::pair<size_t, double>> CylinderMesh::interpolation_weights(std::vector<double> const& position) const
+{
+	CylinderGeometry const& geometry = *_geometry;
+	if (position.size() != 2)
 	{
-		// bottom of cylinder
-		_on_boundary[i * _height_meshsize] = true;
-		// top of cylinder
-		_on_boundary[i * _height_meshsize + _height_meshsize - 1] = true;
+		return {};
 	}
-	for (size_t j = 0; j < _height_meshsize; j++)
+	std::vector<std::pair<size_t, double>> weights;
+	for (auto const& radial : axis_interpolation(geometry.r, position[0] / 1000000))
 	{
-		// curved edge of cylinder
-		_on_boundary[(_radial_meshsize - 1) * _height_meshsize + j] = true;
+		for (auto const& axial : equally_spaced_interpolation(geometry.full_height_meshsize, geometry.height_meshsize,
+			geometry.dz, position[1] / 1000000))
+		{
+			weights.push_back({ radial.first * geometry.height_meshsize + axial.first, radial.second * axial.second });
+		}
 	}
+	return weights;
+}
+std::vector<size_t> const& CylinderMesh::boundary_points() const
+{
+	return _geometry->boundary_points;
+}
+size_t CylinderMesh::meshsize(size_t const axis) const
+{
+	return (axis == 0) ? _geometry->radial_meshsize : _geometry->height_meshsize;
+}
+
+CylinderMesh::CylinderMesh(ConfFileData& conf_file_data, std::string const& mesh_name) 
+	: Mesh(conf_file_data._cylinder_radial_meshsize
+		* solved_meshsize(conf_file_data._cylinder_height_meshsize, conf_file_data._symmetry_reduction),
+		conf_file_data.output_path(mesh_name))
+{
+	_geometry = std::make_shared<CylinderGeometry const>(conf_file_data);
+}
+CylinderMesh::CylinderMesh(CylinderMesh const& mesh, std::string const& mesh_name)
+	: Mesh(mesh._mesh_size, mesh.sibling_name(mesh_name))
+{
+	_geometry = mesh._geometry;
 }
 CylinderMesh::CylinderMesh(CylinderMesh const& mesh)
 	: Mesh(mesh)
 {
-	_radius = mesh._radius;
-	_height = mesh._height;
-	_radial_meshsize = mesh._radial_meshsize;
-	_height_meshsize = mesh._height_meshsize;
-	_dr = mesh._dr;
-	_dz = mesh._dz;
-
-	_at_centre = mesh._at_centre;
-	_on_boundary = mesh._on_boundary;
-	
-
+	_geometry = mesh._geometry;
 }
 
 double CylinderMesh::laplacian(size_t const index) const
 {
-	size_t i = index / _height_meshsize;
-	size_t j = index % _height_meshsize;
+	CylinderGeometry const& geometry = *_geometry;
+	size_t const height_meshsize = geometry.height_meshsize;
+	double const dz = geometry.dz;
+	size_t i = index / height_meshsize;
+	size_t j = index % height_meshsize;
 
 	if (is_on_boundary(index))
 	{
 		throw std::runtime_error("Incorrect index entered for mesh.\n");
 	}
+	else if (geometry.fourth_order)
+	{
+		return stencil_sum(geometry.radial_stencil, i, _mesh_data, j, height_meshsize)
+			+ stencil_sum(geometry.axial_stencil, j, _mesh_data, i * height_meshsize, 1);
+	}
 	else
 	{
 		// Useful variables
-		size_t cell_position = i * _height_meshsize + j;
-		size_t radius_plus = (i + 1) * _height_meshsize + j;
-		size_t height_plus = i * _height_meshsize + j + 1;
-		size_t height_minus = i * _height_meshsize + j - 1;
+		size_t cell_position = i * height_meshsize + j;
+		size_t radius_plus = (i + 1) * height_meshsize + j;
+		size_t height_plus = i * height_meshsize + next_index(j, height_meshsize);
+		size_t height_minus = i * height_meshsize + j - 1;
 
 		if (is_at_centre(i, j))
 		{
 			// polar contribution (different at r = 0)
 			double laplace_polar_part =
-				4 * (_mesh_data[radius_plus] - _mesh_data[cell_position]) / (_dr * _dr);
+				geometry.radial_plus[i] * (_mesh_data[radius_plus] - _mesh_data[cell_position]);
 
 			// axial contribution
 			double laplace_axial_part =
-				(_mesh_data[height_plus] - 2 * _mesh_data[cell_position] + _mesh_data[height_minus]) / (_dz * _dz);
+				(_mesh_data[height_plus] - 2 * _mesh_data[cell_position] + _mesh_data[height_minus]) / (dz * dz);
 
 			return laplace_polar_part + laplace_axial_part;
 		}
 		else
 		{
 			// Extra useful variable
-			size_t radius_minus = (i - 1) * _height_meshsize + j;
+			size_t radius_minus = (i - 1) * height_meshsize + j;
 
 			// polar contribution
 			double laplace_polar_part =
-				(_mesh_data[radius_plus] - 2 * _mesh_data[cell_position] + _mesh_data[radius_minus]) / (_dr * _dr)
-				+ (_mesh_data[radius_plus] - _mesh_data[cell_position]) / (i * _dr * _dr);
+				geometry.radial_plus[i] * (_mesh_data[radius_plus] - _mesh_data[cell_position])
+				+ geometry.radial_minus[i] * (_mesh_data[radius_minus] - _mesh_data[cell_position]);
 
 			// axial contribution
 			double laplace_axial_part =
-				(_mesh_data[height_plus] - 2 * _mesh_data[cell_position] + _mesh_data[height_minus]) / (_dz * _dz);
+				(_mesh_data[height_plus] - 2 * _mesh_data[cell_position] + _mesh_data[height_minus]) / (dz * dz);
 
 			return laplace_polar_part + laplace_axial_part;
 		}
 	}
 }
 
+double CylinderMesh::stability_weight() const
+{
+	CylinderGeometry const& geometry = *_geometry;
+	if (geometry.fourth_order)
+	{
+		// the spectral radius of the sum of the radial and axial parts is the sum of theirs
+		return (geometry.radial_stencil.spectral_radius + geometry.axial_stencil.spectral_radius) / 2;
+	}
+
+	// largest diagonal coefficient of the Laplace operator
+	double weight = 0.0;
+	for (size_t i = 0; i < geometry.radial_meshsize - 1; i++)
+	{
+		weight = std::max(weight, geometry.radial_plus[i] + geometry.radial_minus[i]);
+	}
+	return weight + 2 / (geometry.dz * geometry.dz);
+}
+
 void CylinderMesh::setup_files()
 {
-	for (size_t j = 0; j < _height_meshsize; j++)
+	CylinderGeometry const& geometry = *_geometry;
+	for (size_t j = 0; j < geometry.full_height_meshsize; j++)
 	{
 		// create filename
-		double const z = j * _dz;
+		double const z = j * geometry.dz;
 		std::string filename = _mesh_name + "_z=" + std::to_string(z) + "m.csv";
 		_filenames.push_back(filename);
 
@@ -317,7 +903,7 @@ void CylinderMesh::setup_files()
 
 		// write top row
 		output_file << ",Distance from centre (microns)";
-		for (size_t i = 0; i < _radial_meshsize - 1; i++)
+		for (size_t i = 0; i < geometry.radial_meshsize - 1; i++)
 		{
 			output_file << ',';
 		}
@@ -325,12 +911,12 @@ void CylinderMesh::setup_files()
 
 		// write second row (containing values of r, in microns)
 		output_file << "Time (s),";
-		for (size_t i = 0; i < _radial_meshsize - 1; i++)
+		for (size_t i = 0; i < geometry.radial_meshsize - 1; i++)
 		{
-			output_file << i * _dr * 1000000 << ',';
+			output_file << geometry.r[i] * 1000000 << ',';
 		}
 
-		output_file << (_radial_meshsize - 1) * _dr * 1000000 << '\n';
+		output_file << geometry.r[geometry.radial_meshsize - 1] * 1000000 << '\n';
 	}
 
 	// files set up and ready
@@ -338,6 +924,7 @@ void CylinderMesh::setup_files()
 }
 void CylinderMesh::write_files(size_t const second_count, size_t const sig_figs)
 {
+	CylinderGeometry const& geometry = *_geometry;
 	if (_files_ready)
 	{
 		// loop over files
@@ -349,12 +936,13 @@ void CylinderMesh::write_files(size_t const second_count, size_t const sig_figs)
 			output_file << std::setprecision(sig_figs);
 
 			// write to file
+			size_t const j = folded_index(index, geometry.full_height_meshsize, geometry.height_meshsize);
 			output_file << second_count << ',';
-			for (size_t i = 0; i < _radial_meshsize - 1; i++)
+			for (size_t i = 0; i < geometry.radial_meshsize - 1; i++)
 			{
-				output_file << (*this)(i, index % _height_meshsize) << ',';
+				output_file << (*this)(i, j) << ',';
 			}
-			output_file << (*this)(_radial_meshsize - 1, index % _height_meshsize) << '\n';
+			output_file << (*this)(geometry.radial_meshsize - 1, j) << '\n';
 			index++;
 		}
 	}
@@ -369,101 +957,148 @@ CuboidMesh
 */
 double& CuboidMesh::operator()(size_t const i, size_t const j, size_t const k)
 {
-	return _mesh_data[i * _y_meshsize * _z_meshsize + j * _z_meshsize + k];
+	return _mesh_data[(i * _geometry->y_meshsize + j) * _geometry->z_meshsize + k];
 }
 bool CuboidMesh::is_on_boundary(size_t const n) const
 {
-	return _on_boundary[n];
+	return _geometry->on_boundary[n];
 }
-
-CuboidMesh::CuboidMesh(ConfFileData& conf_file_data, std::string const& mesh_name)
-	: Mesh(conf_file_data._x_meshsize * conf_file_data._y_meshsize * conf_file_data._z_meshsize, mesh_name)
+std::vector<size_t> const& CuboidMesh::interior_points() const
 {
-	_x_length = conf_file_data._x_length;
-	_y_length = conf_file_data._y_length;
-	_z_length = conf_file_data._z_length;
-	_x_meshsize = conf_file_data._x_meshsize;
-	_y_meshsize = conf_file_data._y_meshsize;
-	_z_meshsize = conf_file_data._z_meshsize;
-
-	// dx, dy, dz are in metres rather than microns
-	_dx = _x_length / (1000000 * (_x_meshsize - 1));
-	_dy = _y_length / (1000000 * (_y_meshsize - 1));
-	_dz = _z_length / (1000000 * (_z_meshsize - 1));
-
-	// mark boundary points
-	_on_boundary.resize(_mesh_size, false);
-	for (size_t i = 0; i < _x_meshsize; i++)
+	return _geometry->interior_points;
+}
+std::vector<double> const& CuboidMesh::point_volumes() const
+{
+	return _geometry->volumes;
+}
+size_t CuboidMesh::centre_point() const
+{
+	return _geometry->centre_point;
+}
+std::vector<std::pair<size_t, double>> CuboidMesh::interpolation_weights(std::vector<double> const& position) const
+{
+	CuboidGeometry const& geometry = *_geometry;
+	if (position.size() != 3)
+	{
+		return {};
+	}
+	auto const x_weights = equally_spaced_interpolation(geometry.full_x_meshsize, geometry.x_meshsize, geometry.dx,
+		position[0] / 1000000);
+	auto const y_weights = equally_spaced_interpolation(geometry.full_y_meshsize, geometry.y_meshsize, geometry.dy,
+		position[1] / 1000000);
+	auto const z_weights = equally_spaced_interpolation(geometry.full_z_meshsize, geometry.z_meshsize, geometry.dz,
+		position[2] / 1000000);
+	std::vector<std::pair<size_t, double>> weights;
+	for (auto const& x : x_weights)
 	{
-		for (size_t j = 0; j < _y_meshsize; j++)
+		for (auto const& y : y_weights)
 		{
-			for (size_t k = 0; k < _z_meshsize; k++)
+			for (auto const& z : z_weights)
 			{
-				if (i == 0 or j == 0 or k == 0 or i == _x_meshsize - 1 or j == _y_meshsize - 1 or k == _z_meshsize - 1)
-				{
-					_on_boundary[i * _y_meshsize * _z_meshsize + j * _z_meshsize + k] = true;
-				}
+				weights.push_back({ x.first * geometry.y_meshsize * geometry.z_meshsize + y.first * geometry.z_meshsize
+					+ z.first, x.second * y.second * z.second });
 			}
 		}
 	}
+	return weights;
+}
+std::vector<size_t> const& CuboidMesh::boundary_points() const
+{
+	return _geometry->boundary_points;
+}
+size_t CuboidMesh::meshsize(size_t const axis) const
+{
+	size_t const meshsizes[3] = { _geometry->x_meshsize, _geometry->y_meshsize, _geometry->z_meshsize };
+	return meshsizes[axis];
+}
+bool CuboidMesh::is_mirrored(size_t const axis) const
+{
+	size_t const full_meshsizes[3] = { _geometry->full_x_meshsize, _geometry->full_y_meshsize, _geometry->full_z_meshsize };
+	return meshsize(axis) != full_meshsizes[axis];
+}
+
+CuboidMesh::CuboidMesh(ConfFileData& conf_file_data, std::string const& mesh_name)
+	: Mesh(solved_meshsize(conf_file_data._x_meshsize, conf_file_data._symmetry_reduction)
+		* solved_meshsize(conf_file_data._y_meshsize, conf_file_data._symmetry_reduction)
+		* solved_meshsize(conf_file_data._z_meshsize, conf_file_data._symmetry_reduction),
+		conf_file_data.output_path(mesh_name))
+{
+	_geometry = std::make_shared<CuboidGeometry const>(conf_file_data);
+}
+CuboidMesh::CuboidMesh(CuboidMesh const& mesh, std::string const& mesh_name)
+	: Mesh(mesh._mesh_size, mesh.sibling_name(mesh_name))
+{
+	_geometry = mesh._geometry;
 }
 CuboidMesh::CuboidMesh(CuboidMesh const& mesh)
 	: Mesh(mesh)
 {
-	_x_length = mesh._x_length;
-	_y_length = mesh._y_length;
-	_z_length = mesh._z_length;
-	_x_meshsize = mesh._x_meshsize;
-	_y_meshsize = mesh._y_meshsize;
-	_z_meshsize = mesh._z_meshsize;
-
-	_dx = mesh._dx;
-	_dy = mesh._dy;
-	_dz = mesh._dz;
-
-	_on_boundary = mesh._on_boundary;
+	_geometry = mesh._geometry;
 }
 
 double CuboidMesh::laplacian(size_t const index) const
 {
-	size_t i = (index / _z_meshsize) / _y_meshsize;
-	size_t j = (index / _z_meshsize) % _y_meshsize;
-	size_t k = index % _z_meshsize;
+	CuboidGeometry const& geometry = *_geometry;
+	size_t const y_meshsize = geometry.y_meshsize;
+	size_t const z_meshsize = geometry.z_meshsize;
+	size_t i = (index / z_meshsize) / y_meshsize;
+	size_t j = (index / z_meshsize) % y_meshsize;
+	size_t k = index % z_meshsize;
 
 	if (is_on_boundary(index))
 	{
 		throw std::runtime_error("Laplace operator not defined on boundary.\n");
 	}
+	else if (geometry.fourth_order)
+	{
+		return stencil_sum(geometry.stencils[0], i, _mesh_data, j * z_meshsize + k, y_meshsize * z_meshsize)
+			+ stencil_sum(geometry.stencils[1], j, _mesh_data, i * y_meshsize * z_meshsize + k, z_meshsize)
+			+ stencil_sum(geometry.stencils[2], k, _mesh_data, (i * y_meshsize + j) * z_meshsize, 1);
+	}
 	else
 	{
 		// Useful variables
-		size_t cell_position = i * _y_meshsize * _z_meshsize + j * _z_meshsize + k;
-		size_t x_plus = (i + 1) * _y_meshsize * _z_meshsize + j * _z_meshsize + k;
-		size_t x_minus = (i - 1) * _y_meshsize * _z_meshsize + j * _z_meshsize + k;
-		size_t y_plus = i * _y_meshsize * _z_meshsize + (j + 1) * _z_meshsize + k;
-		size_t y_minus = i * _y_meshsize * _z_meshsize + (j - 1) * _z_meshsize + k;
-		size_t z_plus = i * _y_meshsize * _z_meshsize + j * _z_meshsize + k + 1;
-		size_t z_minus = i * _y_meshsize * _z_meshsize + j * _z_meshsize + k - 1;
+		size_t cell_position = i * y_meshsize * z_meshsize + j * z_meshsize + k;
+		size_t x_plus = next_index(i, geometry.x_meshsize) * y_meshsize * z_meshsize + j * z_meshsize + k;
+		size_t x_minus = (i - 1) * y_meshsize * z_meshsize + j * z_meshsize + k;
+		size_t y_plus = i * y_meshsize * z_meshsize + next_index(j, y_meshsize) * z_meshsize + k;
+		size_t y_minus = i * y_meshsize * z_meshsize + (j - 1) * z_meshsize + k;
+		size_t z_plus = i * y_meshsize * z_meshsize + j * z_meshsize + next_index(k, z_meshsize);
+		size_t z_minus = i * y_meshsize * z_meshsize + j * z_meshsize + k - 1;
 
 		double laplace_x_part =
-			(_mesh_data[x_plus] - 2 * _mesh_data[cell_position] + _mesh_data[x_minus]) / (_dx * _dx);
+			(_mesh_data[x_plus] - 2 * _mesh_data[cell_position] + _mesh_data[x_minus]) / (geometry.dx * geometry.dx);
 		double laplace_y_part =
-			(_mesh_data[y_plus] - 2 * _mesh_data[cell_position] + _mesh_data[y_minus]) / (_dy * _dy);
+			(_mesh_data[y_plus] - 2 * _mesh_data[cell_position] + _mesh_data[y_minus]) / (geometry.dy * geometry.dy);
 		double laplace_z_part =
-			(_mesh_data[z_plus] - 2 * _mesh_data[cell_position] + _mesh_data[z_minus]) / (_dz * _dz);
+			(_mesh_data[z_plus] - 2 * _mesh_data[cell_position] + _mesh_data[z_minus]) / (geometry.dz * geometry.dz);
 
 		return laplace_x_part + laplace_y_part + laplace_z_part;
 	}
 }
+double CuboidMesh::stability_weight() const
+{
+	CuboidGeometry const& geometry = *_geometry;
+	if (geometry.fourth_order)
+	{
+		// half the spectral radius of the sum of the parts along each axis
+		return (geometry.stencils[0].spectral_radius + geometry.stencils[1].spectral_radius
+			+ geometry.stencils[2].spectral_radius) / 2;
+	}
+
+	// diagonal coefficient of the Laplace operator, the same at every interior point
+	return 2 / (geometry.dx * geometry.dx) + 2 / (geometry.dy * geometry.dy) + 2 / (geometry.dz * geometry.dz);
+}
 void CuboidMesh::setup_files()
 {
-	for (size_t i = 0; i < _x_meshsize; i++)
+	CuboidGeometry const& geometry = *_geometry;
+	for (size_t i = 0; i < geometry.full_x_meshsize; i++)
 	{
-		for (size_t j = 0; j < _y_meshsize; j++)
+		for (size_t j = 0; j < geometry.full_y_meshsize; j++)
 		{
 			// create filename
-			double const x = i * _dx;
-			double const y = j * _dy;
+			double const x = i * geometry.dx;
+			double const y = j * geometry.dy;
 			std::string filename = _mesh_name + "_x=" + std::to_string(x)
 				+ "m,y=" + std::to_string(y) + "m.csv";
 			_filenames.push_back(filename);
@@ -473,7 +1108,7 @@ void CuboidMesh::setup_files()
 
 			// write top row
 			output_file << ",Distance along z-axis (microns)";
-			for (size_t k = 0; k < _z_meshsize - 1; k++)
+			for (size_t k = 0; k < geometry.full_z_meshsize - 1; k++)
 			{
 				output_file << ',';
 			}
@@ -481,24 +1116,26 @@ void CuboidMesh::setup_files()
 
 			// write second row (containing values of z, in microns)
 			output_file << "Time (s),";
-			for (size_t k = 0; k < _z_meshsize - 1; k++)
+			for (size_t k = 0; k < geometry.full_z_meshsize - 1; k++)
 			{
-				output_file << k * _dz * 1000000 << ',';
+				output_file << k * geometry.dz * 1000000 << ',';
 			}
-			output_file << (_z_meshsize - 1) * _dz * 1000000 << '\n';
+			output_file << (geometry.full_z_meshsize - 1) * geometry.dz * 1000000 << '\n';
 		}
 	}
 	_files_ready = true;
 }
 void CuboidMesh::write_files(size_t const second_count, size_t const sig_figs)
 {
+	CuboidGeometry const& geometry = *_geometry;
+	size_t const full_z_meshsize = geometry.full_z_meshsize;
 	if (_files_ready)
 	{
 		size_t index = 0;
 		for (auto& filename : _filenames)
 		{
-			size_t i = index / _y_meshsize;
-			size_t j = index % _y_meshsize;
+			size_t i = folded_index(index / geometry.full_y_meshsize, geometry.full_x_meshsize, geometry.x_meshsize);
+			size_t j = folded_index(index % geometry.full_y_meshsize, geometry.full_y_meshsize, geometry.y_meshsize);
 
 			// open file to append
 			std::ofstream output_file(filename, std::ofstream::app);
@@ -506,11 +1143,11 @@ void CuboidMesh::write_files(size_t const second_count, size_t const sig_figs)
 
 			// write to file
 			output_file << second_count << ',';
-			for (size_t k = 0; k < _z_meshsize; k++)
+			for (size_t k = 0; k < full_z_meshsize; k++)
 			{
-				output_file << (*this)(i, j, k) << ',';
+				output_file << (*this)(i, j, folded_index(k, full_z_meshsize, geometry.z_meshsize)) << ',';
 			}
-			output_file << (*this)(i, j, _z_meshsize - 1) << '\n';
+			output_file << (*this)(i, j, folded_index(full_z_meshsize - 1, full_z_meshsize, geometry.z_meshsize)) << '\n';
 			index++;
 		}
 		
@@ -519,4 +1156,4 @@ void CuboidMesh::write_files(size_t const second_count, size_t const sig_figs)
 	{
 		throw std::runtime_error("Files not set up.\n");
 	}
-}
\ No newline at end of file
+}
@@ -1,8 +1,113 @@
 #pragma once
+#include <array>
+#include <memory>
 #include <vector>
 #include <string>
+#include <utility>
 #include "ConfFileData.h"
 
+/*
+Fourth-order finite difference stencil along one axis of a mesh (spatial_order=4): the part of the Laplace
+operator from this axis at point i along it is the sum over e of weights[i][e] * u[points[i][e]].
+*/
+struct AxisStencil
+{
+	std::vector<std::array<size_t, 6>> points;
+	std::vector<std::array<double, 6>> weights;
+	// largest magnitude of an eigenvalue of the stencil, which sets its explicit stability limit
+	double spectral_radius = 0.0;
+};
+
+/*
+Geometry of a mesh: the boundary and centre points, lists of the interior and boundary points (so kernels can
+loop over each without testing every point), and the coordinates and coefficients of the Laplace operator.
+It is built once for each mesh and shared by every field on it (a field is created from the ConfFileData, or on
+the geometry of another field).
+*/
+struct MeshGeometry
+{
+	std::vector<bool> on_boundary;
+	std::vector<bool> at_centre;
+	std::vector<size_t> interior_points;
+	std::vector<size_t> boundary_points;
+
+	// Volume (in m^3) of the particle each point stands for: its cell, which is cut in half at the surface, counted
+	// once for each of its mirror images with symmetry_reduction=true, so the volumes add up to the whole particle
+	std::vector<double> volumes;
+	// the point at the centre of the particle (or the nearest below it, if the meshsizes are even)
+	size_t centre_point = 0;
+
+	// fill interior_points and boundary_points from on_boundary
+	void list_points();
+};
+
+struct SphereGeometry : MeshGeometry
+{
+	double radius;
+	size_t radial_meshsize;
+
+	// Radial coordinates (in metres) and coefficients of the radial part of the Laplace operator
+	std::vector<double> r;
+	std::vector<double> radial_plus;
+	std::vector<double> radial_minus;
+
+	// Fourth-order stencil (used instead of the coefficients above if spatial_order=4)
+	bool fourth_order;
+	AxisStencil radial_stencil;
+
+	SphereGeometry(ConfFileData const& conf_file_data);
+};
+
+struct CylinderGeometry : MeshGeometry
+{
+	double radius;
+	double height;
+	size_t radial_meshsize;
+	size_t height_meshsize;
+	double dz;
+
+	// Number of points along the axis in output; with symmetry_reduction=true only the lower half of the cylinder
+	// (height_meshsize points, up to and including the mid-plane) is solved
+	size_t full_height_meshsize;
+
+	// Radial coordinates (in metres) and coefficients of the radial part of the Laplace operator
+	std::vector<double> r;
+	std::vector<double> radial_plus;
+	std::vector<double> radial_minus;
+
+	// Fourth-order stencils (used instead of the coefficients above if spatial_order=4)
+	bool fourth_order;
+	AxisStencil radial_stencil;
+	AxisStencil axial_stencil;
+
+	CylinderGeometry(ConfFileData const& conf_file_data);
+};
+
+struct CuboidGeometry : MeshGeometry
+{
+	double x_length;
+	double y_length;
+	double z_length;
+	size_t x_meshsize;
+	size_t y_meshsize;
+	size_t z_meshsize;
+	double dx;
+	double dy;
+	double dz;
+
+	// Number of points along each axis in output; with symmetry_reduction=true only the octant nearest the origin
+	// (x_meshsize by y_meshsize by z_meshsize points, up to and including the mid-planes) is solved
+	size_t full_x_meshsize;
+	size_t full_y_meshsize;
+	size_t full_z_meshsize;
+
+	// Fourth-order stencils along each axis (used if spatial_order=4)
+	bool fourth_order;
+	AxisStencil stencils[3];
+
+	CuboidGeometry(ConfFileData const& conf_file_data);
+};
+
 class Mesh
 {
 protected:
@@ -15,6 +120,9 @@ protected:
 	std::vector<std::string> _filenames;
 	bool _files_ready = false;
 
+	// name for another field written to the same directory as this one
+	std::string sibling_name(std::string const& mesh_name) const;
+
 public:
 	Mesh(size_t const mesh_size, std::string const& mesh_name);
 	Mesh(Mesh const& mesh);
@@ -23,25 +131,23 @@ public:
 	const double& operator[](size_t const index) const;
 
 	size_t size() const;
+	// all the values, in index order
+	std::vector<double> const& values() const;
+	// output files of the field (once they are set up)
+	std::vector<std::string> const& filenames() const;
 	void fill(double const value);
+	// exchange values with another field of the same size, leaving the names and files of both as they were
+	void swap_values(Mesh& mesh);
+	// take the values of another field of the same size, leaving the names and files of this one as they were
+	void copy_values(Mesh const& mesh);
 	double virtual laplacian(size_t const index) const;
-	bool nearly_equal(Mesh& other);
-	bool is_nan() const;
+	double virtual stability_weight() const;
 };
 
 class SphereMesh : public Mesh
 {
 protected:
-	// Mesh variables
-	double _radius;
-	size_t _radial_meshsize;
-	double _dr;
-
-	// At centre array
-	std::vector<bool> _at_centre;
-
-	// On boundary array
-	std::vector<bool> _on_boundary;
+	std::shared_ptr<SphereGeometry const> _geometry;
 
 	// operator() for internal use
 	double& operator()(size_t const i);
@@ -51,30 +157,30 @@ protected:
 
 public:
 	SphereMesh(ConfFileData& conf_file_data, std::string const& mesh_name);
+	// a new field (filled with zeros) on the geometry of mesh, written to the same directory
+	SphereMesh(SphereMesh const& mesh, std::string const& mesh_name);
 	SphereMesh(SphereMesh const& mesh);
 	double laplacian(size_t const index) const;
+	double stability_weight() const;
 	void setup_files();
 	void write_files(size_t const second_count, size_t const sig_figs);
 	// easier semantics for accessing on_boundary array
 	bool is_on_boundary(size_t const n) const;
+	std::vector<size_t> const& interior_points() const;
+	std::vector<size_t> const& boundary_points() const;
+	// volume of the particle each point stands for, and the point at its centre (see MeshGeometry)
+	std::vector<double> const& point_volumes() const;
+	size_t centre_point() const;
+	// points and weights interpolating linearly at a distance r from the centre, as {r} in microns (none outside)
+	std::vector<std::pair<size_t, double>> interpolation_weights(std::vector<double> const& position) const;
+	// number of points along axis 0 (r)
+	size_t meshsize(size_t const axis) const;
 };
 
 class CylinderMesh : public Mesh
 {
 protected:
-	// Mesh variables
-	double _radius;
-	double _height;
-	size_t _radial_meshsize;
-	size_t _height_meshsize;
-	double _dr;
-	double _dz;
-
-	// At centre array
-	std::vector<bool> _at_centre;
-
-	// On boundary array
-	std::vector<bool> _on_boundary;
+	std::shared_ptr<CylinderGeometry const> _geometry;
 
 	// operator() for internal use
 	double& operator()(size_t const i, size_t const j);
@@ -84,30 +190,30 @@ protected:
 
 public:
 	CylinderMesh(ConfFileData& conf_file_data, std::string const& mesh_name);
+	// a new field (filled with zeros) on the geometry of mesh, written to the same directory
+	CylinderMesh(CylinderMesh const& mesh, std::string const& mesh_name);
 	CylinderMesh(CylinderMesh const& mesh);
 	double laplacian(size_t const index) const;
+	double stability_weight() const;
 	void setup_files();
 	void write_files(size_t const second_count, size_t const sig_figs);
 	// easier semantics for accessing on_boundary array
 	bool is_on_boundary(size_t const n) const;
+	std::vector<size_t> const& interior_points() const;
+	std::vector<size_t> const& boundary_points() const;
+	// volume of the particle each point stands for, and the point at its centre (see MeshGeometry)
+	std::vector<double> const& point_volumes() const;
+	size_t centre_point() const;
+	// points and weights interpolating linearly at {r, z} in microns from the centre of the bottom (none outside)
+	std::vector<std::pair<size_t, double>> interpolation_weights(std::vector<double> const& position) const;
+	// number of points solved along axis 0 (r) or 1 (z)
+	size_t meshsize(size_t const axis) const;
 };
 
 class CuboidMesh : public Mesh
 {
 protected:
-	// Mesh variables
-	double _x_length;
-	double _y_length;
-	double _z_length;
-	size_t _x_meshsize;
-	size_t _y_meshsize;
-	size_t _z_meshsize;
-	double _dx;
-	double _dy;
-	double _dz;
-
-	// on boundary array
-	std::vector<bool> _on_boundary;
+	std::shared_ptr<CuboidGeometry const> _geometry;
 
 	// operator() for internal use
 	double& operator()(size_t const i, size_t const j, size_t const k);
@@ -115,10 +221,23 @@ protected:
 
 public:
 	CuboidMesh(ConfFileData& conf_file_data, std::string const& mesh_name);
+	// a new field (filled with zeros) on the geometry of mesh, written to the same directory
+	CuboidMesh(CuboidMesh const& mesh, std::string const& mesh_name);
 	CuboidMesh(CuboidMesh const& mesh);
 	double laplacian(size_t const index) const;
+	double stability_weight() const;
 	void setup_files();
 	void write_files(size_t const second_count, size_t const sig_figs);
 	// easier semantics for accessing on_boundary array
 	bool is_on_boundary(size_t const n) const;
-};
\ No newline at end of file
+	std::vector<size_t> const& interior_points() const;
+	std::vector<size_t> const& boundary_points() const;
+	// volume of the particle each point stands for, and the point at its centre (see MeshGeometry)
+	std::vector<double> const& point_volumes() const;
+	size_t centre_point() const;
+	// points and weights interpolating linearly at {x, y, z} in microns from a corner (none outside)
+	std::vector<std::pair<size_t, double>> interpolation_weights(std::vector<double> const& position) const;
+	// number of points solved along axis 0 (x), 1 (y) or 2 (z), and whether the last of them is on a mid-plane
+	size_t meshsize(size_t const axis) const;
+	bool is_mirrored(size_t const axis) const;
+};
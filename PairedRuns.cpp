@@ -0,0 +1,141 @@
+#include "PairedRuns.h"
+#include "Mesh.h"
+#include <exception>
+#include <filesystem>
+#include <thread>
+
+template <typename M>
+PairedRuns<M>::PairedRuns(std::vector<size_t> const& first_points, std::vector<size_t> const& second_points,
+	Compare compare)
+	: _compare(compare)
+{
+	_points[0] = first_points;
+	_points[1] = second_points;
+}
+
+template <typename M>
+void PairedRuns<M>::add(size_t const run, size_t const second, M const& temp, std::vector<M> const& chem_meshes)
+{
+	// copy out the compared values before taking the lock, so the runs wait on each other less
+	size_t const number_of_points = _points[run].empty() ? temp.size() : _points[run].size();
+	Solution solution(1 + chem_meshes.size(), std::vector<double>(number_of_points));
+	for (size_t index = 0; index < number_of_points; index++)
+	{
+		size_t const point = _points[run].empty() ? index : _points[run][index];
+		solution[0][index] = temp[point];
+		for (size_t species = 0; species < chem_meshes.size(); species++)
+		{
+			solution[1 + species][index] = chem_meshes[species][point];
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_last[run] = solution;
+	_waiting[run][second] = std::move(solution);
+	compare_ready_seconds();
+
+	// wait for the other run once this one is too far ahead (it can't be waiting too, as it has none of these
+	// seconds)
+	_compared.wait(lock, [&]() { return _waiting[run].size() < MAX_WAITING or _finished[1 - run]; });
+}
+
+template <typename M>
+void PairedRuns<M>::finish(size_t const run)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_finished[run] = true;
+	compare_ready_seconds();
+	_compared.notify_all();
+}
+
+template <typename M>
+void PairedRuns<M>::compare_ready_seconds()
+{
+	while (true)
+	{
+		Solution const* solutions[2] = { nullptr, nullptr };
+		for (size_t run = 0; run < 2; run++)
+		{
+			auto const found = _waiting[run].find(_next_second);
+			if (found != _waiting[run].end())
+			{
+				solutions[run] = &found->second;
+			}
+			else if (_finished[run])
+			{
+				solutions[run] = &_last[run];
+			}
+		}
+		bool const both_finished = _waiting[0].empty() and _waiting[1].empty() and _finished[0] and _finished[1];
+		if (not solutions[0] or not solutions[1] or both_finished)
+		{
+			return;
+		}
+
+		_compare(_next_second, *solutions[0], *solutions[1]);
+		_waiting[0].erase(_next_second);
+		_waiting[1].erase(_next_second);
+		_next_second++;
+		_compared.notify_all();
+	}
+}
+
+template <typename M>
+void PairedRuns<M>::run(ConfFileData* conf_file_data[2], CSVFileData& csv_file_data, SolverHooks<M> hooks[2],
+	std::string const log_filenames[2])
+{
+	// an error in either run (which throws in batch mode, see Log.h) is passed on once both have stopped
+	std::vector<std::thread> runs;
+	std::exception_ptr errors[2];
+	for (size_t run = 0; run < 2; run++)
+	{
+		runs.emplace_back([&, run]()
+		{
+			try
+			{
+				std::ofstream run_log_file(log_filenames[run]);
+				conf_file_data[run]->log_input(run_log_file);
+
+				hooks[run].on_second = [this, run](size_t const second, M const& temp, std::vector<M> const& chem_meshes)
+				{
+					add(run, second, temp, chem_meshes);
+				};
+				heateqn_solver<M>(*conf_file_data[run], csv_file_data, run_log_file, hooks[run]);
+			}
+			catch (...)
+			{
+				errors[run] = std::current_exception();
+			}
+			finish(run);
+		});
+	}
+	for (auto& run : runs)
+	{
+		run.join();
+	}
+	for (auto& error : errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+template <typename M>
+size_t PairedRuns<M>::seconds_compared() const
+{
+	return _next_second;
+}
+
+std::string run_log_filename(std::string const& log_filename, std::string const& prefix)
+{
+	std::filesystem::path path(log_filename);
+	path.replace_filename(prefix + path.filename().string());
+	return path.string();
+}
+
+// to keep the linker happy, need to instantiate concrete versions of the template classes
+template class PairedRuns<SphereMesh>;
+template class PairedRuns<CylinderMesh>;
+template class PairedRuns<CuboidMesh>;
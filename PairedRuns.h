@@ -0,0 +1,64 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+#include "heateqn_solver.h"
+
+/*
+Two runs of the solver at the same time, each on its own thread with its own log file, whose solutions are handed
+over at every output second and paired up by second (used by Richardson.h and PrecisionCheck.h). Each second is
+compared and released as soon as both runs have reached it. Either run can be ahead, so the solutions of the run
+that is ahead are kept until the other catches up, but only up to MAX_WAITING seconds: the run then waits for the
+other before carrying on, so at most that many solutions are held however far apart the runs' speeds are. The
+runs can also reach equilibrium at different times; after that the last solution of the run that has finished
+stands for it.
+*/
+template <typename M>
+class PairedRuns
+{
+public:
+	// solution at the compared points: the temperature, then the remaining fraction of each species
+	using Solution = std::vector<std::vector<double>>;
+	// called with the solutions of the two runs at each second in turn
+	using Compare = std::function<void(size_t const time, Solution const& first, Solution const& second)>;
+
+private:
+	std::mutex _mutex;
+	std::condition_variable _compared;
+	Compare _compare;
+
+	// indices of the compared points in the meshes of each run (every point, in order, if empty)
+	std::vector<size_t> _points[2];
+
+	// solutions of each run waiting to be compared, and the last solution of each
+	std::map<size_t, Solution> _waiting[2];
+	Solution _last[2];
+	bool _finished[2] = { false, false };
+	size_t _next_second = 0;
+
+	void add(size_t const run, size_t const second, M const& temp, std::vector<M> const& chem_meshes);
+	void finish(size_t const run);
+	// compare every second both runs have reached (the caller holds _mutex)
+	void compare_ready_seconds();
+
+public:
+	PairedRuns(std::vector<size_t> const& first_points, std::vector<size_t> const& second_points, Compare compare);
+
+	// Run the solver with each of the settings and hooks (on_second is set here), writing the log of each run to
+	// its own file; returns once both have finished
+	void run(ConfFileData* conf_file_data[2], CSVFileData& csv_file_data, SolverHooks<M> hooks[2],
+		std::string const log_filenames[2]);
+
+	size_t seconds_compared() const;
+
+	// Seconds a run can be ahead of the other before it waits
+	static size_t const MAX_WAITING = 2;
+};
+
+// Log file of one of the runs, next to the main log file, with prefix added to its name
+std::string run_log_filename(std::string const& log_filename, std::string const& prefix);
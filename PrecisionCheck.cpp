@@ -0,0 +1,81 @@
+#include "PrecisionCheck.h"
+#include "ChemSpecies.h"
+#include "Log.h"
+#include "Mesh.h"
+#include "PairedRuns.h"
+#include "PropertyTable.h"
+#include "heateqn_solver.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+// the differences are far below the precision std::to_string shows
+static std::string scientific(double const value)
+{
+	std::ostringstream stream;
+	stream << std::scientific << std::setprecision(3) << value;
+	return stream.str();
+}
+
+template <typename M>
+void precision_check_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file)
+{
+	// property tables shared by both runs
+	PropertyTable const& property_table = property_table_for(conf_file_data, log_file);
+
+	// both runs take the same timesteps
+	ConfFileData mixed_conf_file_data = conf_file_data;
+	std::vector<ChemSpecies> chem_species_array = csv_file_data._chem_array;
+	plan_timesteps_per_second(mixed_conf_file_data, chem_species_array, property_table,
+		M(mixed_conf_file_data, "output_temp"), log_file);
+	mixed_conf_file_data._auto_timestep = false;
+	ConfFileData double_conf_file_data = mixed_conf_file_data;
+	double_conf_file_data._mixed_precision = false;
+
+	// largest differences between the runs over the whole run
+	double max_temp_difference = 0.0;
+	double max_chem_difference = 0.0;
+	using Solution = typename PairedRuns<M>::Solution;
+	PairedRuns<M> runs({}, {}, [&](size_t const second, Solution const& mixed, Solution const& all_double)
+	{
+		double temp_difference = 0.0;
+		double chem_difference = 0.0;
+		for (size_t field = 0; field < mixed.size(); field++)
+		{
+			double& difference = (field == 0) ? temp_difference : chem_difference;
+			for (size_t index = 0; index < mixed[field].size(); index++)
+			{
+				difference = std::max(difference, std::abs(mixed[field][index] - all_double[field][index]));
+			}
+		}
+		Log::write_to_log_file(log_file, "Mixed precision check at " + std::to_string(second)
+			+ " seconds: largest difference in temperature " + scientific(temp_difference)
+			+ " K, in remaining fraction " + scientific(chem_difference) + ".\n");
+		max_temp_difference = std::max(max_temp_difference, temp_difference);
+		max_chem_difference = std::max(max_chem_difference, chem_difference);
+	});
+
+	ConfFileData* run_conf_file_data[2] = { &mixed_conf_file_data, &double_conf_file_data };
+	SolverHooks<M> hooks[2];
+	std::string const prefixes[2] = { "", "double_" };
+	std::string log_filenames[2];
+	for (size_t run = 0; run < 2; run++)
+	{
+		hooks[run].output_prefix = prefixes[run];
+		hooks[run].property_table = &property_table;
+		log_filenames[run] = run_log_filename(conf_file_data.output_path(conf_file_data._log_filename),
+			(run == 0) ? "mixed_" : prefixes[run]);
+	}
+	runs.run(run_conf_file_data, csv_file_data, hooks, log_filenames);
+
+	Log::write(log_file, "Mixed precision check: over " + std::to_string(runs.seconds_compared())
+		+ " seconds of output, the largest difference from the all-double run was "
+		+ scientific(max_temp_difference) + " K in temperature and " + scientific(max_chem_difference)
+		+ " in the remaining fraction of any species.\n");
+}
+
+// to keep the linker happy, need to instantiate concrete versions of the template functions
+template void precision_check_solver<SphereMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
+template void precision_check_solver<CylinderMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
+template void precision_check_solver<CuboidMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
@@ -0,0 +1,15 @@
+#pragma once
+#include <fstream>
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+
+/*
+Check of mixed_precision=true (mixed_precision_check=true in settings.conf).
+
+The configuration is run twice at the same time with the same timesteps and property tables, once with the
+property fields stored as float (writing the usual output files) and once with every field stored as double
+(writing output files prefixed with double_). At every output second the largest differences between
+the two in temperature and in the remaining fraction of any species are written to the log file.
+*/
+template <typename M>
+void precision_check_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file);
@@ -0,0 +1,44 @@
+#include "Probes.h"
+#include <iomanip> // for std::setprecision
+
+ProbeRecorder::ProbeRecorder(std::string const& path,
+	std::vector<std::vector<std::pair<size_t, double>>> const& weights, std::vector<std::string> const& names,
+	size_t const significant_digits)
+	: _file(path), _weights(weights)
+{
+	_file << "Time (s)";
+	for (auto const& name : names)
+	{
+		_file << ',' << name;
+	}
+	_file << '\n';
+	_buffer << std::setprecision(significant_digits);
+}
+
+void ProbeRecorder::sample(double const time, std::vector<double> const& temp)
+{
+	_buffer << time;
+	for (auto const& probe : _weights)
+	{
+		double value = 0.0;
+		for (auto const& point : probe)
+		{
+			value += point.second * temp[point.first];
+		}
+		_buffer << ',' << value;
+	}
+	_buffer << '\n';
+}
+
+void ProbeRecorder::write()
+{
+	_file << _buffer.str();
+	_file.flush();
+	discard();
+}
+
+void ProbeRecorder::discard()
+{
+	_buffer.str(std::string());
+	_buffer.clear();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+Virtual probes (probes in settings.conf), like thermocouples at fixed positions in the particle.
+
+The temperature at each probe is interpolated linearly from the points around it, with weights worked out once
+from the mesh (see interpolation_weights in Mesh.h), and sampled probe_samples_per_second times a second, at the
+end of the first timestep to reach each sampling time (so at every timestep if there are fewer timesteps than
+samples per second), which gives histories much finer than the once a second of the full fields.
+The samples of each second are kept in memory and only written to probes.csv once the second is over, so a second
+that is rolled back after diverging drops its samples too.
+*/
+class ProbeRecorder
+{
+private:
+	std::ofstream _file;
+	std::ostringstream _buffer;
+	// points and weights interpolating the value at each probe
+	std::vector<std::vector<std::pair<size_t, double>>> _weights;
+
+public:
+	// names are used as the column headings
+	ProbeRecorder(std::string const& path, std::vector<std::vector<std::pair<size_t, double>>> const& weights,
+		std::vector<std::string> const& names, size_t const significant_digits);
+
+	// Add a sample of the temperatures at time (in seconds), given the temperature at every point
+	void sample(double const time, std::vector<double> const& temp);
+	// Write the samples taken since the last call to the file
+	void write();
+	// Drop the samples taken since the last call to write()
+	void discard();
+};
@@ -0,0 +1,199 @@
+#include "PropertyTable.h"
+#include "ConfFileData.h"
+#include "thermodynamics.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+/*
+ConstantPropertyModel
+*/
+
+ConstantPropertyModel::ConstantPropertyModel(double heat_capacity, double thermal_conductivity)
+{
+	_heat_capacity = heat_capacity;
+	_thermal_conductivity = thermal_conductivity;
+}
+double ConstantPropertyModel::heat_capacity(double) const
+{
+	return _heat_capacity;
+}
+double ConstantPropertyModel::thermal_conductivity(double) const
+{
+	return _thermal_conductivity;
+}
+
+/*
+WaplesPropertyModel
+*/
+
+WaplesPropertyModel::WaplesPropertyModel(double heat_capacity_at_20, double thermal_conductivity_at_20,
+	bool fixed_heat_capacity, bool fixed_thermal_conductivity)
+{
+	_heat_capacity_at_20 = heat_capacity_at_20;
+	_thermal_conductivity_at_20 = thermal_conductivity_at_20;
+	_fixed_heat_capacity = fixed_heat_capacity;
+	_fixed_thermal_conductivity = fixed_thermal_conductivity;
+}
+double WaplesPropertyModel::heat_capacity(double temp) const
+{
+	if (_fixed_heat_capacity)
+	{
+		return _heat_capacity_at_20;
+	}
+	return waples_heat_capacity(_heat_capacity_at_20, temp);
+}
+double WaplesPropertyModel::thermal_conductivity(double temp) const
+{
+	if (_fixed_thermal_conductivity)
+	{
+		return _thermal_conductivity_at_20;
+	}
+	return waples_thermal_conductivity(_thermal_conductivity_at_20, temp);
+}
+
+std::shared_ptr<const PropertyModel> make_property_model(ConfFileData const& cf)
+{
+	if (cf._fixed_specific_heat_capacity and cf._fixed_thermal_conductivity)
+	{
+		return std::make_shared<ConstantPropertyModel>(cf._specific_heat_capacity, cf._thermal_conductivity);
+	}
+	return std::make_shared<WaplesPropertyModel>(cf._specific_heat_capacity, cf._thermal_conductivity,
+		cf._fixed_specific_heat_capacity, cf._fixed_thermal_conductivity);
+}
+
+/*
+PropertyTable
+*/
+
+PropertyTable::PropertyTable(std::shared_ptr<const PropertyModel> model, double rock_density,
+	double low_temp, double high_temp, double tolerance)
+{
+	_model = model;
+	_rock_density = rock_density;
+	_low_temp = low_temp;
+	_high_temp = high_temp;
+
+	// double the number of intervals until interpolation is accurate enough
+	size_t intervals = 16;
+	build(intervals);
+	while (max_relative_error() > tolerance and intervals < (1 << 20))
+	{
+		intervals *= 2;
+		build(intervals);
+	}
+}
+
+void PropertyTable::build(size_t const intervals)
+{
+	_dT = (_high_temp - _low_temp) / intervals;
+	_inverse_dT = 1 / _dT;
+	_heat_capacity.resize(intervals + 1);
+	_thermal_conductivity.resize(intervals + 1);
+	_thermal_diffusivity.resize(intervals + 1);
+
+	for (size_t n = 0; n <= intervals; n++)
+	{
+		double const temp = _low_temp + n * _dT;
+		_heat_capacity[n] = _model->heat_capacity(temp);
+		_thermal_conductivity[n] = _model->thermal_conductivity(temp);
+		_thermal_diffusivity[n] = _thermal_conductivity[n] / (_rock_density * _heat_capacity[n]);
+	}
+}
+
+double PropertyTable::interpolate(std::vector<double> const& table, double const temp) const
+{
+	double const position = (temp - _low_temp) * _inverse_dT;
+	size_t const n = static_cast<size_t>(position);
+	double const fraction = position - n;
+	return table[n] + fraction * (table[n + 1] - table[n]);
+}
+
+double PropertyTable::max_relative_error() const
+{
+	// compare with the model at the midpoint and quarter points of every interval
+	double max_error = 0.0;
+	for (size_t n = 0; n + 1 < _heat_capacity.size(); n++)
+	{
+		for (double fraction : { 0.25, 0.5, 0.75 })
+		{
+			double const temp = _low_temp + (n + fraction) * _dT;
+			double const heat_capacity = _model->heat_capacity(temp);
+			double const thermal_conductivity = _model->thermal_conductivity(temp);
+			double const thermal_diffusivity = thermal_conductivity / (_rock_density * heat_capacity);
+
+			max_error = std::max(max_error, std::abs(interpolate(_heat_capacity, temp) / heat_capacity - 1));
+			max_error = std::max(max_error, std::abs(interpolate(_thermal_conductivity, temp) / thermal_conductivity - 1));
+			max_error = std::max(max_error, std::abs(interpolate(_thermal_diffusivity, temp) / thermal_diffusivity - 1));
+		}
+	}
+	return max_error;
+}
+
+double PropertyTable::heat_capacity(double const temp) const
+{
+	if (not (temp >= _low_temp and temp < _high_temp))
+	{
+		return _model->heat_capacity(temp);
+	}
+	return interpolate(_heat_capacity, temp);
+}
+double PropertyTable::thermal_conductivity(double const temp) const
+{
+	if (not (temp >= _low_temp and temp < _high_temp))
+	{
+		return _model->thermal_conductivity(temp);
+	}
+	return interpolate(_thermal_conductivity, temp);
+}
+double PropertyTable::thermal_diffusivity(double const temp) const
+{
+	if (not (temp >= _low_temp and temp < _high_temp))
+	{
+		return _model->thermal_conductivity(temp) / (_rock_density * _model->heat_capacity(temp));
+	}
+	return interpolate(_thermal_diffusivity, temp);
+}
+
+double PropertyTable::max_thermal_diffusivity() const
+{
+	return *std::max_element(_thermal_diffusivity.begin(), _thermal_diffusivity.end());
+}
+size_t PropertyTable::size() const
+{
+	return _thermal_diffusivity.size();
+}
+
+/*
+Tables kept between runs
+*/
+
+PropertyTable const& property_table_for(ConfFileData const& cf, std::ofstream& log_file)
+{
+	static std::mutex mutex;
+	static std::map<std::vector<double>, std::unique_ptr<const PropertyTable>> tables;
+
+	// everything the tables depend on
+	double const low_temp = cf._initial_temp + 273.15 - 50;
+	double const high_temp = cf.peak_temperature() + 273.15 + 50;
+	std::vector<double> const key = { double(cf._fixed_specific_heat_capacity), double(cf._fixed_thermal_conductivity),
+		cf._specific_heat_capacity, cf._thermal_conductivity, cf._rock_density, low_temp, high_temp,
+		cf._property_table_tolerance };
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unique_ptr<const PropertyTable>& table = tables[key];
+	if (table)
+	{
+		Log::write(log_file, "Property tables with " + std::to_string(table->size())
+			+ " points reused from an earlier run.\n");
+	}
+	else
+	{
+		table = std::make_unique<const PropertyTable>(make_property_model(cf), cf._rock_density, low_temp, high_temp,
+			cf._property_table_tolerance);
+		Log::write(log_file, "Property tables built with " + std::to_string(table->size()) + " points.\n");
+	}
+	return *table;
+}
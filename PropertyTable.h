@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <fstream>
+#include "ConfFileData.h"
+
+// Interface for temperature dependent physical properties of the bulk material
+class PropertyModel
+{
+public:
+	virtual ~PropertyModel() = default;
+	// specific heat capacity (J/kg/K) at temperature temp (in Kelvin)
+	virtual double heat_capacity(double temp) const = 0;
+	// thermal conductivity (W/m/K) at temperature temp (in Kelvin)
+	virtual double thermal_conductivity(double temp) const = 0;
+};
+
+// Properties fixed at their values at 20 Celsius
+class ConstantPropertyModel : public PropertyModel
+{
+private:
+	double _heat_capacity;
+	double _thermal_conductivity;
+
+public:
+	ConstantPropertyModel(double heat_capacity, double thermal_conductivity);
+	double heat_capacity(double temp) const;
+	double thermal_conductivity(double temp) const;
+};
+
+// Waples models (see thermodynamics.h); either property may be held fixed instead
+class WaplesPropertyModel : public PropertyModel
+{
+private:
+	double _heat_capacity_at_20;
+	double _thermal_conductivity_at_20;
+	bool _fixed_heat_capacity;
+	bool _fixed_thermal_conductivity;
+
+public:
+	WaplesPropertyModel(double heat_capacity_at_20, double thermal_conductivity_at_20,
+		bool fixed_heat_capacity, bool fixed_thermal_conductivity);
+	double heat_capacity(double temp) const;
+	double thermal_conductivity(double temp) const;
+};
+
+// Choose the property model described by the settings
+std::shared_ptr<const PropertyModel> make_property_model(ConfFileData const& conf_file_data);
+
+/*
+Tables of heat capacity, thermal conductivity and thermal diffusivity on an evenly spaced grid of temperatures,
+refined until linear interpolation between grid points reproduces the model to within a relative tolerance.
+Temperatures outside the table fall back to evaluating the model directly.
+*/
+class PropertyTable
+{
+private:
+	std::shared_ptr<const PropertyModel> _model;
+	double _rock_density;
+	double _low_temp;
+	double _high_temp;
+	double _dT;
+	double _inverse_dT;
+	std::vector<double> _heat_capacity;
+	std::vector<double> _thermal_conductivity;
+	std::vector<double> _thermal_diffusivity;
+
+	void build(size_t const intervals);
+	double interpolate(std::vector<double> const& table, double const temp) const;
+	double max_relative_error() const;
+
+public:
+	PropertyTable(std::shared_ptr<const PropertyModel> model, double rock_density,
+		double low_temp, double high_temp, double tolerance);
+
+	double heat_capacity(double const temp) const;
+	double thermal_conductivity(double const temp) const;
+	double thermal_diffusivity(double const temp) const;
+
+	// largest thermal diffusivity in the table
+	double max_thermal_diffusivity() const;
+	size_t size() const;
+};
+
+// Property tables for the settings, over the temperature range of the run with a margin of 50 K either side.
+// Tables are kept for the life of the program and handed to later runs with the same property settings and range,
+// such as later jobs of the server (see Server.h), rather than being built again.
+PropertyTable const& property_table_for(ConfFileData const& conf_file_data, std::ofstream& log_file);
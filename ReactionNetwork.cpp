@@ -0,0 +1,327 @@
+#include "ReactionNetwork.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+// remove spaces (and the carriage returns of files written on Windows) from both ends of text
+static std::string trim(std::string const& text)
+{
+	size_t const first = text.find_first_not_of(" \t\r");
+	if (first == std::string::npos)
+	{
+		return std::string();
+	}
+	return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+static std::vector<std::string> split(std::string const& text, char const separator)
+{
+	std::vector<std::string> fields;
+	std::stringstream text_stream(text);
+	std::string field;
+	while (std::getline(text_stream, field, separator))
+	{
+		fields.push_back(trim(field));
+	}
+	return fields;
+}
+
+ReactionNetwork::ReactionNetwork(std::istream& network_file)
+{
+	// species first, so reactions can name species given after them
+	std::vector<std::vector<std::string>> reaction_lines;
+	std::string line;
+	while (std::getline(network_file, line))
+	{
+		line = trim(line.substr(0, line.find('#')));
+		if (line.empty())
+		{
+			continue;
+		}
+		std::vector<std::string> const fields = split(line, ',');
+		if (fields[0] == "species" and fields.size() == 3)
+		{
+			if (std::find(_species_names.begin(), _species_names.end(), fields[1]) != _species_names.end())
+			{
+				throw std::runtime_error("Species " + fields[1] + " is given twice in the reaction network.");
+			}
+			_species_names.push_back(fields[1]);
+			_initial_amounts.push_back(std::stod(fields[2]));
+		}
+		else if (fields[0] == "reaction" and (fields.size() == 6 or fields.size() == 7))
+		{
+			reaction_lines.push_back(fields);
+		}
+		else
+		{
+			throw std::runtime_error("Could not read reaction network line: " + line);
+		}
+	}
+	if (reaction_lines.empty())
+	{
+		throw std::runtime_error("The reaction network has no reactions.");
+	}
+
+	_reactants_start.push_back(0);
+	_changes_start.push_back(0);
+	for (auto const& fields : reaction_lines)
+	{
+		double const A = std::stod(fields[1]);
+		double const Ea = std::stod(fields[2]);
+		double const dH = std::stod(fields[3]);
+		double const molar_mass = std::stod(fields[4]);
+		// the whole heat of the reaction, rather than a proportion of it
+		_reactions.push_back(ChemSpecies(A, Ea * 4184, 100.0, dH, molar_mass));
+
+		std::vector<Term> const reactants = parse_terms(fields[5]);
+		std::vector<Term> const products = (fields.size() == 7) ? parse_terms(fields[6]) : std::vector<Term>();
+		if (reactants.empty())
+		{
+			throw std::runtime_error("A reaction in the reaction network has no reactants.");
+		}
+		_reactants.insert(_reactants.end(), reactants.begin(), reactants.end());
+		_reactants_start.push_back(_reactants.size());
+
+		// net change of each species, in order of species
+		for (size_t species = 0; species < number_of_species(); species++)
+		{
+			double change = 0.0;
+			for (auto const& reactant : reactants)
+			{
+				change -= (reactant.species == species) ? reactant.coefficient : 0.0;
+			}
+			for (auto const& product : products)
+			{
+				change += (product.species == species) ? product.coefficient : 0.0;
+			}
+			if (change != 0.0)
+			{
+				_changes.push_back({ species, change, 0.0 });
+			}
+		}
+		_changes_start.push_back(_changes.size());
+	}
+
+	// first order in one reactant throughout, so backward Euler steps are linear
+	_linear = true;
+	for (size_t reaction = 0; reaction < number_of_reactions(); reaction++)
+	{
+		_linear = _linear and (_reactants_start[reaction + 1] - _reactants_start[reaction] == 1)
+			and (_reactants[_reactants_start[reaction]].order == 1.0);
+	}
+
+	// independent if, besides, each reactant only ever changes by its own reaction using it up
+	_independent = _linear;
+	_products_start.push_back(0);
+	std::vector<size_t> uses(number_of_species(), 0);
+	for (auto const& reactant : _reactants)
+	{
+		uses[reactant.species]++;
+	}
+	for (size_t reaction = 0; reaction < number_of_reactions(); reaction++)
+	{
+		for (size_t term = _changes_start[reaction]; term < _changes_start[reaction + 1]; term++)
+		{
+			Term const& change = _changes[term];
+			bool const own_reactant = _linear and (change.species == reactant(reaction));
+			bool const used_up = own_reactant and (change.coefficient == -reactant_coefficient(reaction));
+			_independent = _independent and (uses[change.species] == 0 or used_up);
+			if (change.coefficient > 0)
+			{
+				_products.push_back(change);
+			}
+		}
+		_products_start.push_back(_products.size());
+	}
+	for (size_t species = 0; species < number_of_species(); species++)
+	{
+		_independent = _independent and uses[species] <= 1;
+		if (uses[species] == 0)
+		{
+			_unreacting_species.push_back(species);
+		}
+	}
+}
+
+size_t ReactionNetwork::species_index(std::string const& name) const
+{
+	auto const found = std::find(_species_names.begin(), _species_names.end(), name);
+	if (found == _species_names.end())
+	{
+		throw std::runtime_error("Species " + name + " in the reaction network hasn't been given a species line.");
+	}
+	return found - _species_names.begin();
+}
+
+// terms such as "0.6 oil + 0.4 gas" or "2 oil^2": [coefficient] name[^order]
+std::vector<ReactionNetwork::Term> ReactionNetwork::parse_terms(std::string const& terms) const
+{
+	std::vector<Term> parsed;
+	if (terms.empty())
+	{
+		return parsed;
+	}
+	for (auto const& term : split(terms, '+'))
+	{
+		std::string name = term;
+		double coefficient = 1.0;
+		double order = 1.0;
+		size_t const space = term.find_first_of(" \t");
+		if (space != std::string::npos)
+		{
+			coefficient = std::stod(term.substr(0, space));
+			name = trim(term.substr(space));
+		}
+		size_t const caret = name.find('^');
+		if (caret != std::string::npos)
+		{
+			order = std::stod(name.substr(caret + 1));
+			name = trim(name.substr(0, caret));
+		}
+		if (coefficient <= 0 or order < 0)
+		{
+			throw std::runtime_error("Coefficients and orders in the reaction network must be positive: " + term);
+		}
+		parsed.push_back({ species_index(name), coefficient, order });
+	}
+	return parsed;
+}
+
+size_t ReactionNetwork::number_of_species() const
+{
+	return _species_names.size();
+}
+
+size_t ReactionNetwork::number_of_reactions() const
+{
+	return _reactions.size();
+}
+
+std::string const& ReactionNetwork::species_name(size_t const species) const
+{
+	return _species_names[species];
+}
+
+double ReactionNetwork::initial_amount(size_t const species) const
+{
+	return _initial_amounts[species];
+}
+
+std::vector<ChemSpecies> const& ReactionNetwork::reactions() const
+{
+	return _reactions;
+}
+
+bool ReactionNetwork::independent() const
+{
+	return _independent;
+}
+
+void ReactionNetwork::implicit_extents(double const* amounts, double const* k, double const dt, double* extents) const
+{
+	size_t const n = number_of_species();
+	/*
+	Backward Euler: solve G(x) = x - amounts - dt f(x) = 0 for the new amounts x, where f is the rate of change of
+	each species, by Newton's method from x = amounts. The Jacobian is dense but only number_of_species square,
+	and is solved by Gaussian elimination with partial pivoting.
+	*/
+	thread_local std::vector<double> x, residual, jacobian;
+	x.assign(amounts, amounts + n);
+	residual.resize(n);
+	jacobian.resize(n * n);
+	size_t const max_iterations = _linear ? 1 : 50;
+	for (size_t iteration = 0; iteration < max_iterations; iteration++)
+	{
+		std::fill(jacobian.begin(), jacobian.end(), 0.0);
+		for (size_t species = 0; species < n; species++)
+		{
+			residual[species] = x[species] - amounts[species];
+			jacobian[species * n + species] = 1.0;
+		}
+		for (size_t reaction = 0; reaction < number_of_reactions(); reaction++)
+		{
+			double const extent = dt * rate(reaction, k[reaction], x.data());
+			for (size_t term = _changes_start[reaction]; term < _changes_start[reaction + 1]; term++)
+			{
+				residual[_changes[term].species] -= _changes[term].coefficient * extent;
+			}
+			// derivative of the extent with respect to each reactant
+			for (size_t term = _reactants_start[reaction]; term < _reactants_start[reaction + 1]; term++)
+			{
+				Term const& reactant = _reactants[term];
+				double derivative = dt * k[reaction];
+				for (size_t other = _reactants_start[reaction]; other < _reactants_start[reaction + 1]; other++)
+				{
+					double const amount = std::max(x[_reactants[other].species], 0.0);
+					double const order = _reactants[other].order;
+					if (other == term)
+					{
+						derivative *= (order == 1.0) ? 1.0
+							: ((amount > 0) ? order * std::pow(amount, order - 1) : 0.0);
+					}
+					else
+					{
+						derivative *= (order == 1.0) ? amount : std::pow(amount, order);
+					}
+				}
+				for (size_t change = _changes_start[reaction]; change < _changes_start[reaction + 1]; change++)
+				{
+					jacobian[_changes[change].species * n + reactant.species] -= _changes[change].coefficient * derivative;
+				}
+			}
+		}
+
+		// solve jacobian * step = -residual, leaving the step in residual
+		for (size_t column = 0; column < n; column++)
+		{
+			size_t pivot = column;
+			for (size_t row = column + 1; row < n; row++)
+			{
+				pivot = (std::abs(jacobian[row * n + column]) > std::abs(jacobian[pivot * n + column])) ? row : pivot;
+			}
+			if (pivot != column)
+			{
+				std::swap_ranges(jacobian.begin() + column * n, jacobian.begin() + (column + 1) * n,
+					jacobian.begin() + pivot * n);
+				std::swap(residual[column], residual[pivot]);
+			}
+			for (size_t row = column + 1; row < n; row++)
+			{
+				double const factor = jacobian[row * n + column] / jacobian[column * n + column];
+				if (factor != 0.0)
+				{
+					for (size_t j = column; j < n; j++)
+					{
+						jacobian[row * n + j] -= factor * jacobian[column * n + j];
+					}
+					residual[row] -= factor * residual[column];
+				}
+			}
+		}
+		double max_step = 0.0;
+		double max_amount = 0.0;
+		for (size_t row = n; row-- > 0;)
+		{
+			double sum = residual[row];
+			for (size_t j = row + 1; j < n; j++)
+			{
+				sum -= jacobian[row * n + j] * residual[j];
+			}
+			residual[row] = sum / jacobian[row * n + row];
+			x[row] -= residual[row];
+			max_step = std::max(max_step, std::abs(residual[row]));
+			max_amount = std::max(max_amount, std::abs(x[row]));
+		}
+		if (max_step <= 1e-13 * (1.0 + max_amount))
+		{
+			break;
+		}
+	}
+
+	// take the extents at the solution, so the amounts and the heat released agree exactly
+	for (size_t reaction = 0; reaction < number_of_reactions(); reaction++)
+	{
+		extents[reaction] = dt * rate(reaction, k[reaction], x.data());
+	}
+}
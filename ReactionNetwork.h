@@ -0,0 +1,156 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <string>
+#include <vector>
+#include "ChemSpecies.h"
+
+/*
+Reaction network chemistry file, for sequential and competing reactions (such as kerogen -> oil -> gas), one
+entry per line ('#' starts a comment):
+	species,<name>,<initial amount>
+	reaction,<A (s^-1)>,<Ea (kcal)>,<dH (J/mol)>,<molar_mass (kg/mol)>,<reactants>,<products>
+Amounts are fractions of the initial organic matter by mass, like the remaining fractions of the independent
+species of the usual chemistry file. Reactants and products are lists of terms joined by '+', each a species
+name with an optional coefficient before it (mass of the species per unit of reaction) and, for reactants, an
+optional order after it as ^order (1 by default); products may be left empty. So
+	reaction,1.7E+13,50,210000,400,kerogen,0.6 oil + 0.4 gas
+converts kerogen to oil and gas at the rate k(T) c_kerogen, and
+	reaction,1.0E+13,52,0,400,2 oil^2,gas
+converts oil to gas at the rate k(T) c_oil^2, using 2 of oil per unit of reaction. The heat of a reaction is
+dH / molar_mass per unit of reaction, as for a species of the usual chemistry file.
+
+The network is compiled into sparse lists of the reactants of each reaction (with their orders) and of the net
+change of each species in each reaction, and each point is advanced by a forward Euler step, or for implicit
+timesteps by a backward Euler step solved by Newton's method, which is stable however stiff the network is.
+*/
+class ReactionNetwork
+{
+private:
+	// a species in a reaction: its coefficient, and for reactants its order
+	struct Term
+	{
+		size_t species;
+		double coefficient;
+		double order;
+	};
+
+	std::vector<std::string> _species_names;
+	std::vector<double> _initial_amounts;
+	// rate constant and enthalpy of each reaction
+	std::vector<ChemSpecies> _reactions;
+
+	// reactants of reaction r are _reactants[_reactants_start[r]] to _reactants[_reactants_start[r + 1] - 1],
+	// and likewise for the net change in each species
+	std::vector<size_t> _reactants_start;
+	std::vector<Term> _reactants;
+	std::vector<size_t> _changes_start;
+	std::vector<Term> _changes;
+	// every reaction is first order in a single reactant, so one Newton iteration solves a backward Euler step
+	bool _linear;
+	// and no reaction produces a reactant (see independent()), with the products of each reaction listed as above
+	bool _independent;
+	std::vector<size_t> _unreacting_species;
+	std::vector<size_t> _products_start;
+	std::vector<Term> _products;
+
+	size_t species_index(std::string const& name) const;
+	std::vector<Term> parse_terms(std::string const& terms) const;
+	double rate(size_t const reaction, double const k, double const* amounts) const;
+	// extents of a backward Euler step
+	void implicit_extents(double const* amounts, double const* k, double const dt, double* extents) const;
+
+public:
+	ReactionNetwork(std::istream& network_file);
+
+	size_t number_of_species() const;
+	size_t number_of_reactions() const;
+	std::string const& species_name(size_t const species) const;
+	double initial_amount(size_t const species) const;
+	// one ChemSpecies per reaction giving its rate constant and enthalpy
+	std::vector<ChemSpecies> const& reactions() const;
+
+	// Independent networks, in which every reaction is first order in a single reactant that no other reaction
+	// uses or produces, like the species of the usual chemistry file, can be integrated one reaction at a time
+	// without gathering every species at a point, exactly for implicit timesteps
+	bool independent() const;
+	// for independent networks, the species a reaction uses, and how much of it per unit of reaction
+	size_t reactant(size_t const reaction) const;
+	double reactant_coefficient(size_t const reaction) const;
+	// the species no reaction uses, which only gain their products
+	std::vector<size_t> const& unreacting_species() const;
+	// Call visit(species, coefficient) for every product of a reaction of an independent network
+	template <typename F>
+	void for_each_product(size_t const reaction, F&& visit) const;
+
+	// Advance the amounts of every species at one point by dt, given the rate constant k of each reaction,
+	// setting new_amounts and extents (how far each reaction went, per unit of reaction)
+	void advance(double const* amounts, double const* k, double const dt, bool const implicit,
+		double* new_amounts, double* extents) const;
+};
+
+// defined here so they can be inlined into the solver's update kernel
+
+// rate of reaction at the given amounts (amounts pushed below zero by a step count as zero)
+inline double ReactionNetwork::rate(size_t const reaction, double const k, double const* amounts) const
+{
+	double rate = k;
+	for (size_t term = _reactants_start[reaction]; term < _reactants_start[reaction + 1]; term++)
+	{
+		Term const& reactant = _reactants[term];
+		double const amount = std::max(amounts[reactant.species], 0.0);
+		rate *= (reactant.order == 1.0) ? amount : std::pow(amount, reactant.order);
+	}
+	return rate;
+}
+
+inline void ReactionNetwork::advance(double const* amounts, double const* k, double const dt, bool const implicit,
+	double* new_amounts, double* extents) const
+{
+	if (implicit)
+	{
+		implicit_extents(amounts, k, dt, extents);
+	}
+	else
+	{
+		for (size_t reaction = 0; reaction < _reactions.size(); reaction++)
+		{
+			extents[reaction] = dt * rate(reaction, k[reaction], amounts);
+		}
+	}
+
+	std::copy(amounts, amounts + _species_names.size(), new_amounts);
+	for (size_t reaction = 0; reaction < _reactions.size(); reaction++)
+	{
+		for (size_t term = _changes_start[reaction]; term < _changes_start[reaction + 1]; term++)
+		{
+			new_amounts[_changes[term].species] += _changes[term].coefficient * extents[reaction];
+		}
+	}
+}
+
+inline std::vector<size_t> const& ReactionNetwork::unreacting_species() const
+{
+	return _unreacting_species;
+}
+
+// (reaction r of an independent network has the single reactant _reactants[r])
+inline size_t ReactionNetwork::reactant(size_t const reaction) const
+{
+	return _reactants[reaction].species;
+}
+
+inline double ReactionNetwork::reactant_coefficient(size_t const reaction) const
+{
+	return _reactants[reaction].coefficient;
+}
+
+template <typename F>
+inline void ReactionNetwork::for_each_product(size_t const reaction, F&& visit) const
+{
+	for (size_t term = _products_start[reaction]; term < _products_start[reaction + 1]; term++)
+	{
+		visit(_products[term].species, _products[term].coefficient);
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+/*
+Parallel reductions over the points of a mesh (deterministic_reductions in settings.conf).
+
+The largest value of something over the points comes out the same however the points are shared out between
+threads, but a sum doesn't: OpenMP adds up the partial sums of the threads in whatever order they finish, so its
+last bits, and whatever depends on them (the end of the cooling phase, the iterations of the linear solvers, the
+heat released in the summary), change with the number of threads. With deterministic_reductions=true the points
+are split into fixed blocks of REDUCTION_BLOCK_SIZE points, each summed in order by whichever thread takes it,
+and the sums of the blocks are added in order afterwards, so a run gives the same results bit for bit on any
+number of threads. The blocks don't depend on the number of threads, so they can be small: small enough that
+meshes of a few thousand points are shared out between the threads, but large enough that adding up their sums
+costs next to nothing.
+*/
+constexpr size_t REDUCTION_BLOCK_SIZE = 256;
+
+// Reductions over the points updated in a timestep of the solver
+struct PointReductions
+{
+	// residual norms
+	double max_change = 0.0;
+	double sum_of_square_changes = 0.0;
+	bool non_finite = false;
+	// fastest heating by chemistry at a point, and the rate of heating by chemistry over the particle (in W)
+	double max_chem_heat = 0.0;
+	double chem_power = 0.0;
+	// largest difference from the boundary temperature
+	double max_deviation = 0.0;
+
+	void combine(PointReductions const& other)
+	{
+		max_change = std::max(max_change, other.max_change);
+		sum_of_square_changes += other.sum_of_square_changes;
+		non_finite = non_finite or other.non_finite;
+		max_chem_heat = std::max(max_chem_heat, other.max_chem_heat);
+		chem_power += other.chem_power;
+		max_deviation = std::max(max_deviation, other.max_deviation);
+	}
+};
+#pragma omp declare reduction(combine : PointReductions : omp_out.combine(omp_in)) initializer(omp_priv = PointReductions())
+
+// defined here so they can be inlined into the solver's update kernel
+
+// Call point(n, reductions) for each n below count in parallel, and return the reductions combined. Unless
+// deterministic, the points are handed out to the threads in chunks of chunk_size as they finish (chosen by
+// auto_tune, see AutoTune.h), or shared out equally beforehand if chunk_size is 0.
+template <typename F>
+inline PointReductions reduce_over_points(size_t const count, bool const deterministic, size_t const chunk_size,
+	F&& point)
+{
+	PointReductions reductions;
+	if (not deterministic and chunk_size > 0)
+	{
+#pragma omp parallel for schedule(dynamic, chunk_size) reduction(combine:reductions)
+		for (size_t n = 0; n < count; n++)
+		{
+			point(n, reductions);
+		}
+		return reductions;
+	}
+	if (not deterministic)
+	{
+#pragma omp parallel for reduction(combine:reductions)
+		for (size_t n = 0; n < count; n++)
+		{
+			point(n, reductions);
+		}
+		return reductions;
+	}
+
+	size_t const blocks = (count + REDUCTION_BLOCK_SIZE - 1) / REDUCTION_BLOCK_SIZE;
+	std::vector<PointReductions> block_reductions(blocks);
+#pragma omp parallel for
+	for (size_t block = 0; block < blocks; block++)
+	{
+		PointReductions block_reduction;
+		for (size_t n = block * REDUCTION_BLOCK_SIZE; n < std::min(count, (block + 1) * REDUCTION_BLOCK_SIZE); n++)
+		{
+			point(n, block_reduction);
+		}
+		block_reductions[block] = block_reduction;
+	}
+	for (auto const& block_reduction : block_reductions)
+	{
+		reductions.combine(block_reduction);
+	}
+	return reductions;
+}
+
+// Sum of term(n) over each n below count, in parallel
+template <typename F>
+inline double parallel_sum(size_t const count, bool const deterministic, F&& term)
+{
+	double sum = 0.0;
+	if (not deterministic)
+	{
+#pragma omp parallel for reduction(+:sum)
+		for (size_t n = 0; n < count; n++)
+		{
+			sum += term(n);
+		}
+		return sum;
+	}
+
+	size_t const blocks = (count + REDUCTION_BLOCK_SIZE - 1) / REDUCTION_BLOCK_SIZE;
+	std::vector<double> block_sums(blocks, 0.0);
+#pragma omp parallel for
+	for (size_t block = 0; block < blocks; block++)
+	{
+		double block_sum = 0.0;
+		for (size_t n = block * REDUCTION_BLOCK_SIZE; n < std::min(count, (block + 1) * REDUCTION_BLOCK_SIZE); n++)
+		{
+			block_sum += term(n);
+		}
+		block_sums[block] = block_sum;
+	}
+	for (double const block_sum : block_sums)
+	{
+		sum += block_sum;
+	}
+	return sum;
+}
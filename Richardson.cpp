@@ -0,0 +1,183 @@
+#include "Richardson.h"
+#include "ChemSpecies.h"
+#include "Log.h"
+#include "Mesh.h"
+#include "PairedRuns.h"
+#include "PropertyTable.h"
+#include "heateqn_solver.h"
+#include <cmath>
+#include <type_traits>
+
+// Settings of the run with every mesh interval halved and four times as many timesteps
+static ConfFileData make_fine_conf_file_data(ConfFileData const& conf_file_data)
+{
+	ConfFileData fine = conf_file_data;
+	fine._sphere_radial_meshsize = 2 * conf_file_data._sphere_radial_meshsize - 1;
+	fine._cylinder_radial_meshsize = 2 * conf_file_data._cylinder_radial_meshsize - 1;
+	fine._cylinder_height_meshsize = 2 * conf_file_data._cylinder_height_meshsize - 1;
+	fine._x_meshsize = 2 * conf_file_data._x_meshsize - 1;
+	fine._y_meshsize = 2 * conf_file_data._y_meshsize - 1;
+	fine._z_meshsize = 2 * conf_file_data._z_meshsize - 1;
+
+	// geometric grading shrinks the spacing by the grading factor per interval, so the fine mesh needs its square
+	// root for every other point to land on the coarse mesh (tanh grading lines up as it is)
+	if (conf_file_data._radial_grading == "geometric")
+	{
+		fine._radial_grading_factor = std::sqrt(conf_file_data._radial_grading_factor);
+	}
+
+	fine._timesteps_per_second = 4 * conf_file_data._timesteps_per_second;
+	fine._cooling_timesteps_per_second = 4 * conf_file_data._cooling_timesteps_per_second;
+	return fine;
+}
+
+// 2^p - 1, where p is the order of the leading error term of the spatial discretisation (see Richardson.h)
+static double error_ratio(ConfFileData const& conf_file_data)
+{
+	bool const first_order = (conf_file_data._geometry != 3 and conf_file_data._radial_grading == "uniform");
+	return first_order ? 1.0 : 3.0;
+}
+
+// Index of each point of the coarse mesh in the fine mesh
+template <typename M>
+static std::vector<size_t> coarse_points_in_fine(M const& coarse, M const& fine)
+{
+	constexpr size_t axes = std::is_same_v<M, SphereMesh> ? 1 : (std::is_same_v<M, CylinderMesh> ? 2 : 3);
+
+	std::vector<size_t> fine_index(coarse.size(), 0);
+	for (size_t index = 0; index < coarse.size(); index++)
+	{
+		// the last axis varies fastest along the mesh arrays
+		size_t remainder = index;
+		size_t fine_stride = 1;
+		for (size_t axis = axes; axis-- > 0;)
+		{
+			fine_index[index] += 2 * (remainder % coarse.meshsize(axis)) * fine_stride;
+			remainder /= coarse.meshsize(axis);
+			fine_stride *= fine.meshsize(axis);
+		}
+	}
+	return fine_index;
+}
+
+// Output files of the extrapolated solution and its error estimates, on the coarse mesh
+template <typename M>
+class RichardsonOutput
+{
+private:
+	size_t _significant_digits;
+	double _error_ratio;
+
+	M _temp;
+	M _temp_error;
+	std::vector<M> _chem;
+	std::vector<M> _chem_error;
+	double _max_temp_error = 0.0;
+	size_t _max_temp_error_second = 0;
+
+public:
+	RichardsonOutput(ConfFileData& conf_file_data, size_t const number_of_species)
+		: _significant_digits(conf_file_data._significant_digits), _error_ratio(error_ratio(conf_file_data)),
+		_temp(conf_file_data, "output_temp"), _temp_error(conf_file_data, "output_temp_error")
+	{
+		for (size_t species = 0; species < number_of_species; species++)
+		{
+			_chem.push_back(M(_temp, "output_chem" + std::to_string(species + 1)));
+			_chem_error.push_back(M(_temp, "output_chem" + std::to_string(species + 1) + "_error"));
+		}
+		_temp.setup_files();
+		_temp_error.setup_files();
+		for (size_t species = 0; species < number_of_species; species++)
+		{
+			_chem[species].setup_files();
+			_chem_error[species].setup_files();
+		}
+	}
+
+	// extrapolate from the solutions of the coarse and fine runs at the coarse points, and write it out
+	void write(size_t const second, std::vector<std::vector<double>> const& coarse,
+		std::vector<std::vector<double>> const& fine)
+	{
+		for (size_t field = 0; field < coarse.size(); field++)
+		{
+			M& extrapolated = (field == 0) ? _temp : _chem[field - 1];
+			M& error = (field == 0) ? _temp_error : _chem_error[field - 1];
+			for (size_t index = 0; index < coarse[field].size(); index++)
+			{
+				double const difference = fine[field][index] - coarse[field][index];
+				extrapolated[index] = fine[field][index] + difference / _error_ratio;
+				error[index] = std::abs(difference) / _error_ratio;
+			}
+			extrapolated.write_files(second, _significant_digits);
+			error.write_files(second, _significant_digits);
+		}
+
+		for (size_t index = 0; index < _temp_error.size(); index++)
+		{
+			if (_temp_error[index] > _max_temp_error)
+			{
+				_max_temp_error = _temp_error[index];
+				_max_temp_error_second = second;
+			}
+		}
+	}
+
+	double max_temp_error() const
+	{
+		return _max_temp_error;
+	}
+	size_t max_temp_error_second() const
+	{
+		return _max_temp_error_second;
+	}
+};
+
+template <typename M>
+void richardson_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file)
+{
+	// property tables shared by both runs
+	PropertyTable const& property_table = property_table_for(conf_file_data, log_file);
+
+	// the timestep is chosen on the coarse mesh, and the fine run takes four times as many
+	ConfFileData coarse_conf_file_data = conf_file_data;
+	std::vector<ChemSpecies> chem_species_array = csv_file_data._chem_array;
+	plan_timesteps_per_second(coarse_conf_file_data, chem_species_array, property_table,
+		M(coarse_conf_file_data, "coarse_output_temp"), log_file);
+	coarse_conf_file_data._auto_timestep = false;
+	ConfFileData fine_conf_file_data = make_fine_conf_file_data(coarse_conf_file_data);
+
+	size_t const number_of_species = conf_file_data._chemistry_on ? csv_file_data.number_of_species() : 0;
+	RichardsonOutput<M> output(coarse_conf_file_data, number_of_species);
+	using Solution = typename PairedRuns<M>::Solution;
+	PairedRuns<M> runs({}, coarse_points_in_fine(M(coarse_conf_file_data, "coarse"), M(fine_conf_file_data, "fine")),
+		[&output](size_t const second, Solution const& coarse, Solution const& fine)
+		{
+			output.write(second, coarse, fine);
+		});
+
+	// run both at once
+	Log::write(log_file, "Richardson extrapolation: running with timesteps_per_second="
+		+ std::to_string(coarse_conf_file_data._timesteps_per_second) + " on the coarse mesh and "
+		+ std::to_string(fine_conf_file_data._timesteps_per_second) + " on the fine mesh.\n");
+	ConfFileData* run_conf_file_data[2] = { &coarse_conf_file_data, &fine_conf_file_data };
+	SolverHooks<M> hooks[2];
+	std::string const prefixes[2] = { "coarse_", "fine_" };
+	std::string log_filenames[2];
+	for (size_t run = 0; run < 2; run++)
+	{
+		hooks[run].output_prefix = prefixes[run];
+		hooks[run].property_table = &property_table;
+		log_filenames[run] = run_log_filename(conf_file_data.output_path(conf_file_data._log_filename), prefixes[run]);
+	}
+	runs.run(run_conf_file_data, csv_file_data, hooks, log_filenames);
+
+	Log::write(log_file, "Richardson extrapolation: combined " + std::to_string(runs.seconds_compared())
+		+ " seconds of output. Largest estimated error in temperature of the fine run was "
+		+ std::to_string(output.max_temp_error()) + " K, at " + std::to_string(output.max_temp_error_second())
+		+ " seconds.\n");
+}
+
+// to keep the linker happy, need to instantiate concrete versions of the template functions
+template void richardson_solver<SphereMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
+template void richardson_solver<CylinderMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
+template void richardson_solver<CuboidMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
@@ -0,0 +1,23 @@
+#pragma once
+#include <fstream>
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+
+/*
+Richardson extrapolation (richardson_on=true in settings.conf).
+
+The configuration is run twice at the same time, on the mesh of settings.conf (spacing h) and on a fine mesh with
+every interval halved (spacing h/2) and four times as many timesteps per second, sharing the chemistry data and
+property tables. The leading error of each run goes as h^p, so at every output second the two are combined at the
+points of the coarse mesh into
+	T = T_fine + (T_fine - T_coarse) / (2^p - 1),
+which cancels it, and |T_fine - T_coarse| / (2^p - 1) estimates the error left in the fine run. The same is done
+for the remaining fraction of each species. p = 2 for the cuboid and graded radial meshes; the equally spaced
+radial stencil takes a one-sided first derivative, so p = 1 for the sphere and cylinder with
+radial_grading="uniform". (The timestep error goes as dt, which is kept proportional to h^2.)
+
+The extrapolated results are written to the usual output files, with the error estimates alongside them
+(output_temp_error etc.), and the two runs write their own output and log files prefixed with coarse_ and fine_.
+*/
+template <typename M>
+void richardson_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file);
@@ -0,0 +1,162 @@
+#include "RunMetrics.h"
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+RunMetrics::RunMetrics(std::string const& path, size_t const mesh_size, double const interval,
+	bool const cooling_phase, double const equilibrium_max_rate)
+	: _path(path), _mesh_size(mesh_size), _interval(interval), _cooling_phase(cooling_phase),
+	_equilibrium_max_rate(equilibrium_max_rate), _phase_start(std::chrono::steady_clock::now()),
+	_last_write(_phase_start)
+{
+}
+
+RunMetrics::Phase RunMetrics::enter_phase(Phase const phase)
+{
+	auto const now = std::chrono::steady_clock::now();
+	_phase_seconds[_phase] += std::chrono::duration<double>(now - _phase_start).count();
+	Phase const previous_phase = _phase;
+	_phase = phase;
+	_phase_start = now;
+	return previous_phase;
+}
+
+void RunMetrics::add_output_files(std::vector<std::string> const& filenames)
+{
+	_output_files.insert(_output_files.end(), filenames.begin(), filenames.end());
+}
+
+// Resident memory of the process in bytes (NaN where /proc isn't available)
+static double resident_bytes()
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.rfind("VmRSS:", 0) == 0)
+		{
+			return std::atof(line.substr(6).c_str()) * 1024;
+		}
+	}
+	return NAN;
+}
+
+// A value as written in the Prometheus text format
+static std::string metric_value(double const value)
+{
+	if (std::isnan(value))
+	{
+		return "NaN";
+	}
+	if (std::isinf(value))
+	{
+		return (value > 0) ? "+Inf" : "-Inf";
+	}
+	std::ostringstream text;
+	text << std::setprecision(10) << value;
+	return text.str();
+}
+
+void RunMetrics::update(Progress const& progress, bool const force)
+{
+	auto const now = std::chrono::steady_clock::now();
+	double const elapsed = std::chrono::duration<double>(now - _last_write).count();
+	if (not force and elapsed < _interval)
+	{
+		return;
+	}
+
+	// rates since the last rewrite
+	double const steps_per_second = (elapsed > 0) ? (progress.timesteps - _last.timesteps) / elapsed : 0.0;
+	double const simulated_per_second = (elapsed > 0)
+		? (progress.simulated_seconds - _last.simulated_seconds) / elapsed : 0.0;
+	// (with no simulated time since the last rewrite, as on a forced one, the rate and so the times left are unknown)
+	double const heating_eta = (progress.heating_seconds_remaining <= 0) ? 0.0
+		: (simulated_per_second > 0) ? progress.heating_seconds_remaining / simulated_per_second : NAN;
+
+	// while cooling, the largest rate of change of temperature decays roughly as exp(-t / tau), so it falls to
+	// equilibrium_max_rate after tau log(rate / equilibrium_max_rate)
+	double cooling_remaining = _cooling_phase ? NAN : 0.0;
+	if (_cooling_phase and progress.cooling)
+	{
+		if (progress.equilibrium_reached or progress.max_rate <= _equilibrium_max_rate)
+		{
+			cooling_remaining = 0.0;
+		}
+		else if (_last.cooling and _last.max_rate > progress.max_rate
+			and progress.simulated_seconds > _last.simulated_seconds)
+		{
+			double const tau = (progress.simulated_seconds - _last.simulated_seconds)
+				/ std::log(_last.max_rate / progress.max_rate);
+			cooling_remaining = tau * std::log(progress.max_rate / _equilibrium_max_rate);
+		}
+	}
+	double const cooling_eta = not (cooling_remaining > 0) ? cooling_remaining
+		: (simulated_per_second > 0) ? cooling_remaining / simulated_per_second : NAN;
+
+	double output_bytes = 0.0;
+	for (auto const& filename : _output_files)
+	{
+		std::error_code error;
+		auto const size = std::filesystem::file_size(filename, error);
+		if (not error)
+		{
+			output_bytes += static_cast<double>(size);
+		}
+	}
+
+	std::ostringstream text;
+	auto metric = [&](std::string const& name, std::string const& type, std::string const& help, double const value)
+	{
+		text << "# HELP heateqn_" << name << ' ' << help << '\n';
+		text << "# TYPE heateqn_" << name << ' ' << type << '\n';
+		text << "heateqn_" << name << ' ' << metric_value(value) << '\n';
+	};
+	metric("simulated_seconds", "gauge", "Simulated time reached.", progress.simulated_seconds);
+	metric("timesteps_total", "counter", "Timesteps taken, including any rolled back.",
+		static_cast<double>(progress.timesteps));
+	metric("timesteps_per_second", "gauge", "Timesteps per second of wall time since the last update.",
+		steps_per_second);
+	metric("point_updates_per_second", "gauge", "Mesh point updates per second of wall time since the last update.",
+		steps_per_second * _mesh_size);
+	metric("heating_eta_seconds", "gauge", "Wall time left until the end of heating, at the current rate.",
+		heating_eta);
+	metric("cooling_remaining_simulated_seconds", "gauge",
+		"Estimated simulated time left in the cooling phase (NaN until it can be estimated).", cooling_remaining);
+	metric("cooling_eta_seconds", "gauge",
+		"Estimated wall time left in the cooling phase (NaN until it can be estimated).", cooling_eta);
+	metric("max_rate_kelvin_per_second", "gauge", "Largest rate of change of temperature in the last timestep.",
+		progress.max_rate);
+	metric("rms_rate_kelvin_per_second", "gauge",
+		"Root mean square rate of change of temperature in the last timestep.", progress.rms_rate);
+	metric("resident_memory_bytes", "gauge", "Resident memory of the process.", resident_bytes());
+	metric("output_bytes", "gauge", "Size of the output files written so far.", output_bytes);
+
+	std::string const phase_names[NUMBER_OF_PHASES] = { "setup", "heating", "cooling", "output" };
+	text << "# HELP heateqn_phase_seconds_total Wall time spent in each phase of the run.\n";
+	text << "# TYPE heateqn_phase_seconds_total counter\n";
+	for (size_t phase = 0; phase < NUMBER_OF_PHASES; phase++)
+	{
+		double seconds = _phase_seconds[phase];
+		if (phase == _phase)
+		{
+			seconds += std::chrono::duration<double>(now - _phase_start).count();
+		}
+		text << "heateqn_phase_seconds_total{phase=\"" << phase_names[phase] << "\"} " << metric_value(seconds) << '\n';
+	}
+
+	// (the metrics are only there to be watched, so failing to write them doesn't stop the run)
+	std::string const temporary_path = _path + ".tmp";
+	{
+		std::ofstream file(temporary_path);
+		file << text.str();
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary_path, _path, error);
+
+	_last = progress;
+	_last_write = now;
+}
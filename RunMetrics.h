@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*
+Live metrics of a run (metrics_file in settings.conf), for watching long runs without reading the log.
+
+The file is rewritten in the Prometheus text exposition format at most every metrics_interval seconds of wall time,
+so a scraper (such as the textfile collector of the Prometheus node exporter) or a dashboard can pick it up; it is
+written to a temporary file first and renamed over the old one, so a reader never sees half of it. It gives the
+simulated time reached, the timesteps and point updates per second of wall time since the last rewrite, the wall
+time left to the end of heating at that rate, an estimate of the simulated and wall time left in the cooling phase
+(once cooling has started, extrapolating the decay of the largest rate of change of temperature since the last
+rewrite down to equilibrium_max_rate), the residual norms of the last timestep, the resident memory of the process,
+the size of the output files written so far and the wall time spent in each phase of the run.
+*/
+class RunMetrics
+{
+public:
+	enum Phase { SETUP, HEATING, COOLING, OUTPUT, NUMBER_OF_PHASES };
+
+	// Progress of the run when the metrics are updated
+	struct Progress
+	{
+		double simulated_seconds = 0.0;
+		// timesteps taken so far, including any rolled back
+		size_t timesteps = 0;
+		double heating_seconds_remaining = 0.0;
+		bool cooling = false;
+		bool equilibrium_reached = false;
+		// largest and root mean square rates of change of temperature in the last timestep (K/s)
+		double max_rate = 0.0;
+		double rms_rate = 0.0;
+	};
+
+private:
+	std::string _path;
+	size_t _mesh_size;
+	double _interval;
+	bool _cooling_phase;
+	double _equilibrium_max_rate;
+	std::vector<std::string> _output_files;
+
+	// wall time spent in each phase, and the phase being timed since _phase_start
+	double _phase_seconds[NUMBER_OF_PHASES] = {};
+	Phase _phase = SETUP;
+	std::chrono::steady_clock::time_point _phase_start;
+
+	// progress at the last rewrite (or none at the start of the run)
+	std::chrono::steady_clock::time_point _last_write;
+	Progress _last;
+
+public:
+	// metrics for a mesh of mesh_size points, rewritten at most every interval seconds; cooling_phase and
+	// equilibrium_max_rate are as in settings.conf
+	RunMetrics(std::string const& path, size_t const mesh_size, double const interval, bool const cooling_phase,
+		double const equilibrium_max_rate);
+
+	// Count the wall time from now on towards phase, returning the phase counted until now
+	Phase enter_phase(Phase const phase);
+	// Add files whose sizes count towards the output written
+	void add_output_files(std::vector<std::string> const& filenames);
+	// Rewrite the file with progress, if interval has passed since the last rewrite or if force is set
+	void update(Progress const& progress, bool const force = false);
+};
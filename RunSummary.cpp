@@ -0,0 +1,99 @@
+#include "RunSummary.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip> // for std::setprecision
+#include <numeric>
+#include <sstream>
+
+RunSummary::RunSummary(std::string const& path, std::vector<double> const& volumes, size_t const centre_point,
+	std::vector<double> const& remaining_weights, std::vector<std::string> const& species_names,
+	std::vector<double> const& conversion_levels, size_t const significant_digits)
+	: _file(path), _volumes(volumes), _centre_point(centre_point), _remaining_weights(remaining_weights),
+	_species_columns(not species_names.empty())
+{
+	_total_volume = std::accumulate(_volumes.begin(), _volumes.end(), 0.0);
+	for (double const level : conversion_levels)
+	{
+		_levels.push_back(level / 100);
+	}
+	_level_times.resize(_levels.size(), NAN);
+
+	_file << std::setprecision(significant_digits);
+	_file << "Time (s),Mean conversion,Heat released (J),Min temperature (K),Max temperature (K),"
+		<< "Centre temperature (K)";
+	for (auto const& name : species_names)
+	{
+		_file << ",Mean " << name;
+	}
+	_file << '\n';
+}
+
+void RunSummary::write(size_t const second, FieldView const& temp, std::vector<FieldView> const& chem,
+	double const heat_released)
+{
+	double min_temp = temp[0];
+	double max_temp = temp[0];
+	for (size_t index = 0; index < temp.size(); index++)
+	{
+		min_temp = std::min(min_temp, temp[index]);
+		max_temp = std::max(max_temp, temp[index]);
+	}
+
+	// volume-weighted mean of each chemistry field, and the organic matter remaining
+	std::vector<double> means(chem.size(), 0.0);
+	double remaining = 0.0;
+	for (size_t field = 0; field < chem.size(); field++)
+	{
+		double total = 0.0;
+		for (size_t index = 0; index < chem[field].size(); index++)
+		{
+			total += _volumes[index] * chem[field][index];
+		}
+		means[field] = total / _total_volume;
+		remaining += _remaining_weights[field] * means[field];
+	}
+	if (second == 0)
+	{
+		_initial_remaining = remaining;
+	}
+	double const conversion = (_initial_remaining > 0) ? 1 - remaining / _initial_remaining : 0.0;
+
+	// interpolate the time each conversion level is first passed
+	for (size_t level = 0; level < _levels.size(); level++)
+	{
+		if (std::isnan(_level_times[level]) and conversion >= _levels[level] and second > 0)
+		{
+			double const fraction = (_levels[level] - _last_conversion) / (conversion - _last_conversion);
+			_level_times[level] = _last_second + fraction * (second - _last_second);
+		}
+	}
+	_last_second = second;
+	_last_conversion = conversion;
+
+	_file << second << ',' << conversion << ',' << heat_released << ',' << min_temp << ',' << max_temp << ','
+		<< temp[_centre_point];
+	for (size_t field = 0; field < chem.size() and _species_columns; field++)
+	{
+		_file << ',' << means[field];
+	}
+	_file << '\n';
+	_file.flush();
+}
+
+std::string RunSummary::conversion_times() const
+{
+	std::ostringstream times;
+	for (size_t level = 0; level < _levels.size(); level++)
+	{
+		times << "Mean conversion " << 100 * _levels[level] << "% ";
+		if (std::isnan(_level_times[level]))
+		{
+			times << "not reached (" << 100 * _last_conversion << "% after " << _last_second << " seconds).\n";
+		}
+		else
+		{
+			times << "reached after " << _level_times[level] << " seconds.\n";
+		}
+	}
+	return times.str();
+}
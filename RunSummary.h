@@ -0,0 +1,47 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include "heateqn_solver.h"
+
+/*
+In-situ summary of a run (summary_output=true in settings.conf), for when the whole fields aren't needed.
+
+At every output second one line of summary.csv gives reductions over the particle, with each point weighted by the
+volume of the particle it stands for (see MeshGeometry in Mesh.h), so graded meshes and symmetry reduction don't
+bias them: the mean conversion of the organic matter, the heat released by chemistry so far (negative if it has
+taken heat in), the lowest, highest and centre temperatures and, for a reaction network, the mean amount of each
+species. The conversion is 1 - remaining / initial remaining, where the remaining organic matter is the sum of the
+mean remaining fractions of the species weighted by their proportions or, for a reaction network, of the mean
+amounts of the species some reaction uses. The times at which it first reaches each of conversion_levels are
+interpolated between output seconds and written to the log at the end of the run.
+*/
+class RunSummary
+{
+private:
+	std::ofstream _file;
+	std::vector<double> _volumes;
+	double _total_volume;
+	size_t _centre_point;
+	// weight of each chemistry field in the remaining organic matter
+	std::vector<double> _remaining_weights;
+	bool _species_columns;
+	double _initial_remaining = 0.0;
+
+	// conversion levels (as fractions), and when they were reached (NaN until then)
+	std::vector<double> _levels;
+	std::vector<double> _level_times;
+	size_t _last_second = 0;
+	double _last_conversion = 0.0;
+
+public:
+	// species_names are given for a reaction network, to add a column for the mean amount of each species
+	RunSummary(std::string const& path, std::vector<double> const& volumes, size_t const centre_point,
+		std::vector<double> const& remaining_weights, std::vector<std::string> const& species_names,
+		std::vector<double> const& conversion_levels, size_t const significant_digits);
+
+	// Write the line for second, given the fields and the heat released by chemistry so far (in J)
+	void write(size_t const second, FieldView const& temp, std::vector<FieldView> const& chem, double const heat_released);
+	// Log lines giving the time at which each conversion level was reached
+	std::string conversion_times() const;
+};
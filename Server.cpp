@@ -0,0 +1,468 @@
+#include "Server.h"
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+#include "Log.h"
+#include "Simulation.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(__unix__) or defined(__APPLE__)
+#define SERVER_SOCKETS
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/*
+ServerConnection
+*/
+
+ServerConnection::ServerConnection(int socket)
+	: _socket(socket)
+{
+}
+
+ServerConnection::~ServerConnection()
+{
+#ifdef SERVER_SOCKETS
+	if (_socket >= 0)
+	{
+		::close(_socket);
+	}
+#endif
+}
+
+void ServerConnection::send(std::string const& line)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (not _open)
+	{
+		return;
+	}
+	if (_socket < 0)
+	{
+		std::cout << line << std::endl;
+		return;
+	}
+#ifdef SERVER_SOCKETS
+	// a client that has gone away gets no more replies (and doesn't raise SIGPIPE)
+	std::string const message = line + '\n';
+	size_t sent = 0;
+	while (sent < message.size())
+	{
+		ssize_t const count = ::send(_socket, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+		if (count <= 0)
+		{
+			_open = false;
+			return;
+		}
+		sent += count;
+	}
+#endif
+}
+
+void ServerConnection::shut_down()
+{
+#ifdef SERVER_SOCKETS
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_socket >= 0)
+	{
+		::shutdown(_socket, SHUT_RD);
+	}
+#endif
+}
+
+/*
+Server
+*/
+
+Server::Server(size_t const number_of_workers)
+{
+	// share the OpenMP threads between the jobs running at once
+	_threads_per_job = 1;
+#ifdef _OPENMP
+	_threads_per_job = std::max<size_t>(1, omp_get_max_threads() / number_of_workers);
+#endif
+	for (size_t worker = 0; worker < number_of_workers; worker++)
+	{
+		_workers.emplace_back(&Server::work, this);
+	}
+}
+
+bool Server::handle(std::string const& line, std::shared_ptr<ServerConnection> const& connection)
+{
+	// command, then key=value arguments
+	std::istringstream words(line);
+	std::string command;
+	words >> command;
+	std::map<std::string, std::string> arguments;
+	std::string word;
+	while (words >> word)
+	{
+		size_t const equals = word.find('=');
+		if (equals == std::string::npos)
+		{
+			connection->send("error Expected key=value, not " + word + ".");
+			return not stopping();
+		}
+		arguments[word.substr(0, equals)] = word.substr(equals + 1);
+	}
+
+	auto argument = [&arguments](std::string const& key)
+	{
+		auto const found = arguments.find(key);
+		return (found == arguments.end()) ? std::string() : found->second;
+	};
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (command.empty())
+	{
+		// ignore blank lines
+	}
+	else if (command == "run")
+	{
+		auto job = std::make_shared<Job>();
+		job->id = argument("id");
+		job->settings = argument("settings");
+		job->chemistry = argument("chemistry");
+		job->output_directory = arguments.count("output") ? argument("output") : job->id;
+		job->state = "queued";
+		job->connection = connection;
+		size_t const known_arguments = arguments.count("id") + arguments.count("settings")
+			+ arguments.count("chemistry") + arguments.count("output");
+		if (known_arguments != arguments.size() or job->id.empty() or job->settings.empty())
+		{
+			connection->send("error run takes id, settings and optionally chemistry and output.");
+		}
+		else if (_jobs_by_id.count(job->id))
+		{
+			connection->send("error There is already a job " + job->id + ".");
+		}
+		else if (_stopping)
+		{
+			connection->send("error The server is stopping.");
+		}
+		else
+		{
+			_jobs.push_back(job);
+			_jobs_by_id[job->id] = job;
+			_queue.push_back(job);
+			connection->send("queued " + job->id);
+			_queue_changed.notify_one();
+		}
+	}
+	else if (command == "status")
+	{
+		if (arguments.count("id"))
+		{
+			auto const found = _jobs_by_id.find(argument("id"));
+			if (found == _jobs_by_id.end())
+			{
+				connection->send("error There is no job " + argument("id") + ".");
+			}
+			else
+			{
+				connection->send(found->second->id + ' ' + found->second->state);
+			}
+		}
+		else
+		{
+			for (auto const& job : _jobs)
+			{
+				connection->send(job->id + ' ' + job->state);
+			}
+		}
+	}
+	else if (command == "quit")
+	{
+		_stopping = true;
+		_queue_changed.notify_all();
+	}
+	else
+	{
+		connection->send("error Unrecognised command " + command + ".");
+	}
+	return not _stopping;
+}
+
+bool Server::stopping()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stopping;
+}
+
+void Server::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+		_queue_changed.notify_all();
+	}
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+void Server::work()
+{
+#ifdef _OPENMP
+	omp_set_num_threads(static_cast<int>(_threads_per_job));
+#endif
+	while (true)
+	{
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_queue_changed.wait(lock, [this]() { return _stopping or not _queue.empty(); });
+			if (_queue.empty())
+			{
+				return;
+			}
+			job = _queue.front();
+			_queue.pop_front();
+			job->state = "running";
+		}
+		job->connection->send("started " + job->id);
+		run_job(*job);
+	}
+}
+
+void Server::run_job(Job& job)
+{
+	auto const clock_start = std::chrono::steady_clock::now();
+	std::string error;
+	try
+	{
+		// ConfFileData reads nothing from a file that isn't there
+		if (not std::ifstream(job.settings).is_open())
+		{
+			throw std::runtime_error("Could not open " + job.settings + ".");
+		}
+		ConfFileData conf_file_data(job.settings);
+		if (not job.chemistry.empty())
+		{
+			conf_file_data._chemistry_file = job.chemistry;
+		}
+		conf_file_data._output_directory = job.output_directory;
+		CSVFileData csv_file_data(conf_file_data._chemistry_file);
+
+		conf_file_data.create_output_directory();
+		std::ofstream log_file(conf_file_data.output_path(conf_file_data._log_filename));
+		Log::write(log_file, job.settings + " and " + conf_file_data._chemistry_file + " read successfully.\n");
+		conf_file_data.log_input(log_file);
+		conf_file_data.check_input(log_file);
+		run_simulation(conf_file_data, csv_file_data, log_file);
+		Log::write(log_file, "Finished!\n");
+	}
+	catch (std::exception const& exception)
+	{
+		// replies are one line each
+		error = exception.what();
+		error.erase(error.find_last_not_of('\n') + 1);
+		std::replace(error.begin(), error.end(), '\n', ' ');
+	}
+	double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - clock_start).count();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		job.state = error.empty() ? "finished" : "failed";
+	}
+	if (error.empty())
+	{
+		job.connection->send("finished " + job.id + " seconds=" + std::to_string(seconds)
+			+ " output=" + job.output_directory);
+	}
+	else
+	{
+		job.connection->send("failed " + job.id + " error=" + error);
+	}
+}
+
+/*
+Reading requests
+*/
+
+#ifdef SERVER_SOCKETS
+// Take requests from connections to a Unix socket at path until one of them sends quit
+static void serve_socket(Server& server, std::string const& path)
+{
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		throw std::runtime_error("Socket path " + path + " is too long.");
+	}
+	std::strcpy(address.sun_path, path.c_str());
+
+	int const listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	::unlink(path.c_str());
+	if (listener < 0 or ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+		or ::listen(listener, 16) != 0)
+	{
+		throw std::runtime_error("Could not listen on socket " + path + ": " + std::strerror(errno) + ".");
+	}
+
+	// a reader that gets quit writes to wake_pipe to stop the wait for connections below (shutting down the
+	// listener only wakes accept on Linux)
+	int wake_pipe[2];
+	if (::pipe(wake_pipe) != 0)
+	{
+		::close(listener);
+		throw std::runtime_error(std::string("Could not create a pipe: ") + std::strerror(errno) + ".");
+	}
+	int const wake_write = wake_pipe[1];
+
+	// each connection is read on its own thread; it is closed once it has been read and its jobs have replied
+	std::vector<std::thread> readers;
+	std::vector<std::weak_ptr<ServerConnection>> connections;
+	while (true)
+	{
+		pollfd waiting[2] = { { listener, POLLIN, 0 }, { wake_pipe[0], POLLIN, 0 } };
+		if (::poll(waiting, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+		if (waiting[1].revents != 0 or server.stopping())
+		{
+			break;
+		}
+		int const socket = ::accept(listener, nullptr, nullptr);
+		if (socket < 0 or server.stopping())
+		{
+			if (socket >= 0)
+			{
+				::close(socket);
+			}
+			break;
+		}
+		auto connection = std::make_shared<ServerConnection>(socket);
+		connections.push_back(connection);
+		readers.emplace_back([&server, connection, socket, wake_write]()
+		{
+			std::string buffer;
+			char chunk[4096];
+			ssize_t count;
+			while ((count = ::recv(socket, chunk, sizeof(chunk), 0)) > 0)
+			{
+				buffer.append(chunk, count);
+				size_t end;
+				while ((end = buffer.find('\n')) != std::string::npos)
+				{
+					std::string line = buffer.substr(0, end);
+					buffer.erase(0, end + 1);
+					if (not server.handle(line, connection))
+					{
+						// wake the wait for connections above
+						[[maybe_unused]] ssize_t const written = ::write(wake_write, "q", 1);
+						return;
+					}
+				}
+			}
+		});
+	}
+
+	// stop reading the connections still open, leaving them to send the replies of their jobs
+	for (auto& connection : connections)
+	{
+		if (auto open_connection = connection.lock())
+		{
+			open_connection->shut_down();
+		}
+	}
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+	::close(wake_pipe[0]);
+	::close(wake_pipe[1]);
+	::close(listener);
+	::unlink(path.c_str());
+}
+#endif
+
+// The number in text if it is a positive whole number, otherwise 0
+static size_t positive_number(std::string const& text)
+{
+	if (text.empty() or not std::isdigit(static_cast<unsigned char>(text[0])))
+	{
+		return 0;
+	}
+	errno = 0;
+	char* end = nullptr;
+	unsigned long long const number = std::strtoull(text.c_str(), &end, 10);
+	return (*end != '\0' or errno == ERANGE) ? 0 : static_cast<size_t>(number);
+}
+
+int run_server(std::vector<std::string> const& arguments)
+{
+	std::string socket_path;
+	size_t number_of_jobs = 1;
+	for (auto const& argument : arguments)
+	{
+		bool valid = true;
+		if (argument.rfind("--socket=", 0) == 0)
+		{
+			socket_path = argument.substr(9);
+		}
+		else if (argument.rfind("--jobs=", 0) == 0)
+		{
+			number_of_jobs = positive_number(argument.substr(7));
+			valid = (number_of_jobs > 0);
+		}
+		else
+		{
+			valid = false;
+		}
+		if (not valid)
+		{
+			std::cerr << "Usage: heateqn_with_chemistry --server [--socket=path] [--jobs=n]\n";
+			return 1;
+		}
+	}
+
+	Log::set_batch_mode(true);
+	Server server(number_of_jobs);
+	int exit_code = 0;
+	if (socket_path.empty())
+	{
+		auto connection = std::make_shared<ServerConnection>(-1);
+		std::string line;
+		while (std::getline(std::cin, line) and server.handle(line, connection))
+		{
+		}
+	}
+	else
+	{
+		try
+		{
+#ifdef SERVER_SOCKETS
+			serve_socket(server, socket_path);
+#else
+			throw std::runtime_error("Sockets aren't supported on this platform.");
+#endif
+		}
+		catch (std::exception const& exception)
+		{
+			std::cerr << exception.what() << '\n';
+			exit_code = 1;
+		}
+	}
+	server.finish();
+	return exit_code;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Batch server (heateqn_with_chemistry --server [--socket=path] [--jobs=n]).
+
+Instead of running settings.conf from the current directory and waiting for ENTER, the program takes jobs from
+stdin, or from any number of connections to a Unix socket at path, and replies on the same stream. Each request
+is one line, a command followed by arguments of the form key=value separated by spaces (so paths can't contain
+spaces); paths are relative to the directory the server was started in.
+	run id=<job> settings=<path> [chemistry=<path>] [output=<directory>]
+		Queue a job: the model described by the settings file, with chemistry_file replaced by chemistry if given,
+		writing its output and log files to output (by default a directory named after the job).
+	status [id=<job>]
+		Report the state of the job, or of every job in the order they were sent.
+	quit
+		Stop taking requests, finish the jobs already queued, then exit. The end of stdin does the same.
+Replies are one line each:
+	queued <job>, started <job>, finished <job> seconds=<wall time> output=<directory>, failed <job> error=<message>
+	<job> queued|running|finished|failed, for each job in reply to status
+	error <message>, for a request that can't be understood
+Up to n jobs (default 1) run at once, each on a worker thread kept for the life of the server with an equal share
+of the OpenMP threads, so the thread teams of each worker and the property tables of earlier jobs
+(see PropertyTable.h) are reused by later jobs. Nothing is written to the console, and errors in a job fail that
+job instead of ending the program (see Log.h).
+*/
+
+// Run the server with the command line arguments following --server; returns the exit code
+int run_server(std::vector<std::string> const& arguments);
+
+// Where replies to the requests read from one stream go
+class ServerConnection
+{
+private:
+	std::mutex _mutex;
+	// socket, or -1 for stdout
+	int _socket;
+	bool _open = true;
+
+public:
+	ServerConnection(int socket);
+	// closes the socket
+	~ServerConnection();
+
+	// write line, unless the other end has gone away
+	void send(std::string const& line);
+	// stop the connection reading any more requests
+	void shut_down();
+};
+
+class Server
+{
+private:
+	struct Job
+	{
+		std::string id;
+		std::string settings;
+		std::string chemistry;
+		std::string output_directory;
+		std::string state;
+		std::shared_ptr<ServerConnection> connection;
+	};
+
+	std::mutex _mutex;
+	std::condition_variable _queue_changed;
+	std::deque<std::shared_ptr<Job>> _queue;
+	// every job sent, for status, in the order they were sent
+	std::vector<std::shared_ptr<Job>> _jobs;
+	std::map<std::string, std::shared_ptr<Job>> _jobs_by_id;
+	bool _stopping = false;
+
+	std::vector<std::thread> _workers;
+	size_t _threads_per_job;
+
+	void work();
+	void run_job(Job& job);
+
+public:
+	Server(size_t const number_of_workers);
+
+	// Carry out the request in line, sending replies to connection; returns false once the server is stopping
+	bool handle(std::string const& line, std::shared_ptr<ServerConnection> const& connection);
+	bool stopping();
+	// Take no more jobs and wait for those already queued to finish
+	void finish();
+};
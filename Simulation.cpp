@@ -0,0 +1,52 @@
+#include "Simulation.h"
+#include "AMRCuboid.h"
+#include "heateqn_solver.h"
+#include "Mesh.h"
+#include "PrecisionCheck.h"
+#include "Richardson.h"
+#include "ThreadCheck.h"
+
+// Run the solver chosen in settings.conf on meshes of type M
+template <typename M>
+static void run_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file)
+{
+	if (conf_file_data._richardson_on)
+	{
+		richardson_solver<M>(conf_file_data, csv_file_data, log_file);
+	}
+	else if (conf_file_data._mixed_precision_check)
+	{
+		precision_check_solver<M>(conf_file_data, csv_file_data, log_file);
+	}
+	else if (conf_file_data._thread_count_check)
+	{
+		thread_check_solver<M>(conf_file_data, csv_file_data, log_file);
+	}
+	else
+	{
+		heateqn_solver<M>(conf_file_data, csv_file_data, log_file);
+	}
+}
+
+void run_simulation(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file)
+{
+	if (conf_file_data._geometry == 1)
+	{
+		run_solver<SphereMesh>(conf_file_data, csv_file_data, log_file);
+	}
+	else if (conf_file_data._geometry == 2)
+	{
+		run_solver<CylinderMesh>(conf_file_data, csv_file_data, log_file);
+	}
+	else if (conf_file_data._geometry == 3)
+	{
+		if (conf_file_data._amr_on)
+		{
+			amr_cuboid_solver(conf_file_data, csv_file_data, log_file);
+		}
+		else
+		{
+			run_solver<CuboidMesh>(conf_file_data, csv_file_data, log_file);
+		}
+	}
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <fstream>
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+
+// Run the model described by checked settings on the geometry and with the solver they choose
+void run_simulation(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file);
@@ -0,0 +1,196 @@
+#include "SolverSession.h"
+#include "Log.h"
+#include "Mesh.h"
+#include <stdexcept>
+#include <type_traits>
+
+// thrown on the solver thread to end a run that is stopped before it has finished
+struct SessionStopped
+{
+};
+
+template <typename M>
+SolverSession<M>::SolverSession(ConfFileData const& conf_file_data, CSVFileData const& csv_file_data,
+	bool const write_files)
+	: _conf_file_data(conf_file_data), _csv_file_data(csv_file_data), _write_files(write_files)
+{
+	size_t const geometry = std::is_same_v<M, SphereMesh> ? 1 : (std::is_same_v<M, CylinderMesh> ? 2 : 3);
+	if (_conf_file_data._geometry != geometry)
+	{
+		throw std::runtime_error("The mesh type of the session doesn't match the geometry setting.");
+	}
+	if (_conf_file_data._richardson_on or _conf_file_data._mixed_precision_check or _conf_file_data._thread_count_check
+		or _conf_file_data._amr_on)
+	{
+		throw std::runtime_error("richardson_on, mixed_precision_check, thread_count_check and amr_on can't be used "
+			"in a session.");
+	}
+
+	// without files the log goes nowhere
+	if (_write_files)
+	{
+		_conf_file_data.create_output_directory();
+		_log_file.open(_conf_file_data.output_path(_conf_file_data._log_filename));
+	}
+	_conf_file_data.log_input(_log_file);
+	_conf_file_data.check_input(_log_file);
+}
+
+template <typename M>
+SolverSession<M>::~SolverSession()
+{
+	if (_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+			_changed.notify_all();
+		}
+		_thread.join();
+	}
+}
+
+template <typename M>
+void SolverSession<M>::add_observer(Observer observer)
+{
+	_observers.push_back(observer);
+}
+
+template <typename M>
+void SolverSession<M>::run()
+{
+	SolverHooks<M> hooks;
+	hooks.write_files = _write_files;
+	hooks.on_fields = [this](size_t const second, M const& temp, SolverFields const& fields)
+	{
+		wait_at_second(second, temp, fields);
+	};
+
+	std::exception_ptr error;
+	try
+	{
+		heateqn_solver<M>(_conf_file_data, _csv_file_data, _log_file, hooks);
+	}
+	catch (SessionStopped const&)
+	{
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_error = error;
+	_finished = true;
+	_temp = nullptr;
+	_fields = nullptr;
+	_changed.notify_all();
+}
+
+template <typename M>
+void SolverSession<M>::wait_at_second(size_t const second, M const& temp, SolverFields const& fields)
+{
+	// hand over the solution, then wait for the next advance() (the fields stay as they are until then)
+	std::unique_lock<std::mutex> lock(_mutex);
+	_second = second;
+	_temp = &temp;
+	_fields = &fields;
+	_waiting = true;
+	_changed.notify_all();
+	_changed.wait(lock, [this]() { return not _waiting or _stopping; });
+	if (_stopping)
+	{
+		throw SessionStopped();
+	}
+}
+
+template <typename M>
+bool SolverSession<M>::advance()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_finished)
+		{
+			return false;
+		}
+		if (not _thread.joinable())
+		{
+			_thread = std::thread(&SolverSession<M>::run, this);
+		}
+		else
+		{
+			_waiting = false;
+			_changed.notify_all();
+		}
+		_changed.wait(lock, [this]() { return _waiting or _finished; });
+		if (_error)
+		{
+			std::exception_ptr error = _error;
+			_error = nullptr;
+			std::rethrow_exception(error);
+		}
+		if (_finished)
+		{
+			return false;
+		}
+	}
+
+	// the solver is waiting, so its fields can be read without the lock
+	for (auto& observer : _observers)
+	{
+		observer(_second, *_temp, *_fields);
+	}
+	return true;
+}
+
+template <typename M>
+void SolverSession<M>::run_to_end()
+{
+	while (advance())
+	{
+	}
+}
+
+template <typename M>
+bool SolverSession<M>::finished() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _finished;
+}
+
+template <typename M>
+ConfFileData const& SolverSession<M>::conf_file_data() const
+{
+	return _conf_file_data;
+}
+
+template <typename M>
+size_t SolverSession<M>::second() const
+{
+	return _second;
+}
+
+template <typename M>
+M const& SolverSession<M>::temp() const
+{
+	if (not _temp)
+	{
+		throw std::runtime_error("The session has no solution to show.");
+	}
+	return *_temp;
+}
+
+template <typename M>
+SolverFields const& SolverSession<M>::fields() const
+{
+	if (not _fields)
+	{
+		throw std::runtime_error("The session has no solution to show.");
+	}
+	return *_fields;
+}
+
+// to keep the linker happy, need to instantiate concrete versions of the template classes
+template class SolverSession<SphereMesh>;
+template class SolverSession<CylinderMesh>;
+template class SolverSession<CuboidMesh>;
@@ -0,0 +1,84 @@
+#pragma once
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+#include "Log.h"
+#include "heateqn_solver.h"
+
+/*
+The solver as a library (libheateqn.a, built by make lib), for running it inside another program.
+
+A SolverSession runs heateqn_solver on meshes of type M (SphereMesh, CylinderMesh or CuboidMesh, matching the
+geometry setting) with settings and chemistry made in memory: ConfFileData can read settings from any stream and
+have them changed afterwards, and CSVFileData can be made from a list of ChemSpecies. The run only moves on when
+asked: each call to advance() runs it to its next output second (0 seconds first) and calls the observers with
+read-only views of the solver's own fields (see SolverFields in heateqn_solver.h), which stay valid, and
+unchanged, until the next call. Output and log files are written only if write_files is set.
+
+Settings are checked as in a normal run, and any error in the settings or during the run is thrown as
+std::runtime_error by the constructor or advance() rather than waiting for ENTER (the session keeps Log in
+batch mode while it exists). richardson_on, mixed_precision_check, thread_count_check and amr_on aren't available
+in a session.
+*/
+template <typename M>
+class SolverSession
+{
+public:
+	// called on the thread calling advance(), with the second reached, the temperature mesh (for its geometry)
+	// and the fields
+	using Observer = std::function<void(size_t const second, M const& temp, SolverFields const& fields)>;
+
+private:
+	// first, so batch mode covers checking the settings and ends only once everything else is gone
+	Log::BatchScope _batch_scope;
+	ConfFileData _conf_file_data;
+	CSVFileData _csv_file_data;
+	std::ofstream _log_file;
+	bool _write_files;
+	std::vector<Observer> _observers;
+
+	// the solver runs on _thread, waiting at each output second until the next advance()
+	std::thread _thread;
+	mutable std::mutex _mutex;
+	std::condition_variable _changed;
+	bool _waiting = false;
+	bool _stopping = false;
+	bool _finished = false;
+	std::exception_ptr _error;
+
+	// the solution at the second the solver is waiting at
+	size_t _second = 0;
+	M const* _temp = nullptr;
+	SolverFields const* _fields = nullptr;
+
+	void run();
+	void wait_at_second(size_t const second, M const& temp, SolverFields const& fields);
+
+public:
+	SolverSession(ConfFileData const& conf_file_data, CSVFileData const& csv_file_data, bool const write_files = false);
+	// stops a run that hasn't finished
+	~SolverSession();
+	SolverSession(SolverSession const&) = delete;
+	SolverSession& operator=(SolverSession const&) = delete;
+
+	void add_observer(Observer observer);
+
+	// Run to the next output second; returns false, without calling the observers, once the run has finished
+	bool advance();
+	// Run to the end
+	void run_to_end();
+
+	bool finished() const;
+	// the settings as used by the run (with timesteps_per_second chosen, if auto_timestep=true)
+	ConfFileData const& conf_file_data() const;
+	// the last second reached and the solution there, until the next advance() (not once finished)
+	size_t second() const;
+	M const& temp() const;
+	SolverFields const& fields() const;
+};
@@ -0,0 +1,98 @@
+#include "ThreadCheck.h"
+#include "ChemSpecies.h"
+#include "Log.h"
+#include "Mesh.h"
+#include "PairedRuns.h"
+#include "PropertyTable.h"
+#include "heateqn_solver.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+template <typename M>
+void thread_check_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file)
+{
+	// property tables shared by both runs
+	PropertyTable const& property_table = property_table_for(conf_file_data, log_file);
+
+	// both runs take the same timesteps
+	ConfFileData single_conf_file_data = conf_file_data;
+	std::vector<ChemSpecies> chem_species_array = csv_file_data._chem_array;
+	plan_timesteps_per_second(single_conf_file_data, chem_species_array, property_table,
+		M(single_conf_file_data, "output_temp"), log_file);
+	single_conf_file_data._auto_timestep = false;
+	ConfFileData threads_conf_file_data = single_conf_file_data;
+
+	size_t threads = 2;
+#ifdef _OPENMP
+	threads = std::max<size_t>(threads, omp_get_max_threads());
+#endif
+	Log::write(log_file, "Thread count check: comparing a run on 1 thread with a run on " + std::to_string(threads)
+		+ " threads.\n");
+
+	// values that differed, and the largest difference, over the whole run
+	size_t total_differences = 0;
+	double max_difference = 0.0;
+	using Solution = typename PairedRuns<M>::Solution;
+	PairedRuns<M> runs({}, {}, [&](size_t const second, Solution const& single, Solution const& threaded)
+	{
+		size_t differences = 0;
+		double difference = 0.0;
+		for (size_t field = 0; field < single.size(); field++)
+		{
+			for (size_t index = 0; index < single[field].size(); index++)
+			{
+				if (single[field][index] != threaded[field][index])
+				{
+					differences++;
+					difference = std::max(difference, std::abs(single[field][index] - threaded[field][index]));
+				}
+			}
+		}
+		std::ostringstream message;
+		message << "Thread count check at " << second << " seconds: " << differences << " value(s) differ";
+		if (differences > 0)
+		{
+			message << ", by up to " << std::scientific << std::setprecision(3) << difference;
+		}
+		Log::write_to_log_file(log_file, message.str() + ".\n");
+		total_differences += differences;
+		max_difference = std::max(max_difference, difference);
+	});
+
+	ConfFileData* run_conf_file_data[2] = { &single_conf_file_data, &threads_conf_file_data };
+	SolverHooks<M> hooks[2];
+	std::string const prefixes[2] = { "", "threads_" };
+	std::string log_filenames[2];
+	for (size_t run = 0; run < 2; run++)
+	{
+		hooks[run].output_prefix = prefixes[run];
+		hooks[run].property_table = &property_table;
+		hooks[run].threads = (run == 0) ? 1 : threads;
+		log_filenames[run] = run_log_filename(conf_file_data.output_path(conf_file_data._log_filename),
+			(run == 0) ? "single_" : prefixes[run]);
+	}
+	runs.run(run_conf_file_data, csv_file_data, hooks, log_filenames);
+
+	std::ostringstream message;
+	message << "Thread count check: over " << runs.seconds_compared() << " seconds of output, ";
+	if (total_differences == 0)
+	{
+		message << "the runs on 1 and " << threads << " threads agreed exactly.\n";
+	}
+	else
+	{
+		message << total_differences << " value(s) differed between the runs on 1 and " << threads
+			<< " threads, by up to " << std::scientific << std::setprecision(3) << max_difference << ".\n";
+	}
+	Log::write(log_file, message.str());
+}
+
+// to keep the linker happy, need to instantiate concrete versions of the template functions
+template void thread_check_solver<SphereMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
+template void thread_check_solver<CylinderMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
+template void thread_check_solver<CuboidMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
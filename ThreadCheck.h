@@ -0,0 +1,16 @@
+#pragma once
+#include <fstream>
+#include "ConfFileData.h"
+#include "CSVFileData.h"
+
+/*
+Check of deterministic_reductions=true (thread_count_check=true in settings.conf).
+
+The configuration is run twice at the same time with the same timesteps and property tables, once on a single
+thread (writing the usual output files) and once on every thread available, or two threads if there is only one
+(writing output files prefixed with threads_). With deterministic_reductions=true the two should agree bit for
+bit, so at every output second the number of values of the temperature and of the remaining fraction of any
+species that differ between them, and the largest difference, are written to the log file.
+*/
+template <typename M>
+void thread_check_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file);
@@ -1,77 +1,302 @@
 #include "ConfFileData.h"
 #include "CSVFileData.h"
 #include "ChemSpecies.h"
+#include "ReactionNetwork.h"
 #include "Mesh.h"
 #include "Log.h"
-#include "thermodynamics.h"
+#include "PropertyTable.h"
+#include "heateqn_solver.h"
+#include "AutoTune.h"
+#include "LinearSolver.h"
+#include "Probes.h"
+#include "Reductions.h"
+#include "RunMetrics.h"
+#include "RunSummary.h"
 #include <fstream>
+#include <memory>
+#include <sstream>
+#include <type_traits>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+/*
+Stability limit of the explicit scheme: the diffusion update is stable for dt < 1 / (D * w), where D is the
+largest thermal diffusivity reached during the run and w is the stability weight of the mesh, and the
+chemistry update is stable for dt < 1 / k, where k is the largest rate constant reached during the run.
+With implicit time integration only the chemistry limit applies.
+*/
 template <typename M>
-void heateqn_solver(ConfFileData& cf, CSVFileData& csv_file_data, std::ofstream& log_file)
+void plan_timesteps_per_second(ConfFileData& cf, std::vector<ChemSpecies>& chem_species_array,
+	PropertyTable const& property_table, M const& mesh, std::ofstream& log_file)
 {
+	double max_rate = (cf._time_integration == "implicit") ? 1.0
+		: property_table.max_thermal_diffusivity() * mesh.stability_weight();
+	if (cf._chemistry_on)
+	{
+		for (auto& species : chem_species_array)
+		{
+			max_rate = std::max(max_rate, species.k(cf.peak_temperature() + 273.15));
+		}
+	}
+	size_t const stable_steps = static_cast<size_t>(std::ceil(max_rate));
+	size_t const recommended_steps = static_cast<size_t>(std::ceil(max_rate / cf._timestep_safety_factor));
+
+	if (cf._auto_timestep)
+	{
+		cf._timesteps_per_second = recommended_steps;
+		Log::write(log_file, "timesteps_per_second set to " + std::to_string(recommended_steps)
+			+ " (stability limit is " + std::to_string(stable_steps) + ").\n");
+	}
+	else if (cf._timesteps_per_second < recommended_steps)
+	{
+		Log::write(log_file, "[WARNING]: timesteps_per_second=" + std::to_string(cf._timesteps_per_second)
+			+ " is below the recommended value of " + std::to_string(recommended_steps) + " (stability limit is "
+			+ std::to_string(stable_steps) + "). The model may diverge.\n");
+	}
+	else if (cf._timesteps_per_second > 4 * recommended_steps)
+	{
+		Log::write(log_file, "[WARNING]: timesteps_per_second=" + std::to_string(cf._timesteps_per_second)
+			+ " is more than four times the recommended value of " + std::to_string(recommended_steps)
+			+ ". Reducing it would shorten the run.\n");
+	}
+}
+
+/*
+FieldView
+*/
+
+FieldView::FieldView(std::vector<double> const& field)
+	: _double_data(field.data()), _size(field.size())
+{
+}
+FieldView::FieldView(std::vector<float> const& field)
+	: _float_data(field.data()), _size(field.size())
+{
+}
+size_t FieldView::size() const
+{
+	return _size;
+}
+double const* FieldView::double_data() const
+{
+	return _double_data;
+}
+float const* FieldView::float_data() const
+{
+	return _float_data;
+}
+
+// Copy a field stored as REAL onto a mesh, for output
+template <typename M, typename REAL>
+static void copy_to_mesh(std::vector<REAL> const& field, M& mesh)
+{
+	for (size_t index = 0; index < mesh.size(); index++)
+	{
+		mesh[index] = field[index];
+	}
+}
+
+/*
+The solver is compiled separately for each combination of the chemistry and fixed property settings,
+so that the checks on them in the update kernel are resolved at compile time, and for the type REAL the
+property fields are stored as (float with mixed_precision=true, otherwise double). Temperature and chemistry are
+always stored as double (a remaining fraction near 1 in float would lose the small decrements of each timestep,
+stalling the reactions), and all arithmetic is in double.
+*/
+template <typename M, typename REAL, bool CHEMISTRY_ON, bool FIXED_HEAT_CAPACITY, bool FIXED_THERMAL_CONDUCTIVITY>
+void heateqn_solver_variant(ConfFileData& cf, CSVFileData& csv_file_data, std::ofstream& log_file,
+	SolverHooks<M> const& hooks)
+{
+	constexpr bool VARIABLE_PROPERTIES = not (FIXED_HEAT_CAPACITY and FIXED_THERMAL_CONDUCTIVITY);
+
 	/* 
 	Set up temperature, thermodynamical and chemistry meshes
 	*/
 	// temperature mesh
-	M temp(cf, "output_temp");
+	M temp(cf, hooks.output_prefix + "output_temp");
 	temp.fill(cf._initial_temp + 273.15);
 
-	// thermodynamical meshes
-	// thermal conductivity
-	M thermal_conductivity(cf, "thermal_conductivity");
-	if (not cf._fixed_thermal_conductivity)
+	// live metrics of the run (see RunMetrics.h), timing the setup from here
+	std::unique_ptr<RunMetrics> metrics;
+	if (hooks.write_files and not cf._metrics_file.empty())
 	{
-		for (size_t i = 0; i < thermal_conductivity.size(); i++)
-		{
-			thermal_conductivity[i] = waples_thermal_conductivity(cf._thermal_conductivity, temp[i]);
-		}
+		metrics = std::make_unique<RunMetrics>(cf.output_path(hooks.output_prefix + cf._metrics_file), temp.size(),
+			cf._metrics_interval, cf._cooling_phase, cf._equilibrium_max_rate);
 	}
-	else
+
+	// thermodynamical meshes, calculated from tables of the property model
+	PropertyTable const& property_table = hooks.property_table ? *hooks.property_table : property_table_for(cf, log_file);
+
+	// temperatures at which the properties at each point were last calculated
+	std::vector<REAL> property_temp(temp.size(), static_cast<REAL>(cf._initial_temp + 273.15));
+
+	// only the thermal diffusivity is kept for the update; heat capacity and thermal conductivity are worked out
+	// from property_temp into the output meshes when they are written, and into fields of their own for on_fields
+	std::vector<REAL> thermal_diffusivity(temp.size());
+	for (size_t i = 0; i < temp.size(); i++)
 	{
-		thermal_conductivity.fill(cf._thermal_conductivity);
+		thermal_diffusivity[i] = static_cast<REAL>(property_table.thermal_diffusivity(temp[i]));
 	}
-
-	// specific heat capacity
-	M heat_capacity(cf, "specific_heat_capacity");
-	if (not cf._fixed_specific_heat_capacity)
+	M thermal_conductivity_mesh(temp, hooks.output_prefix + "thermal_conductivity");
+	M heat_capacity_mesh(temp, hooks.output_prefix + "specific_heat_capacity");
+	std::vector<REAL> thermal_conductivity(hooks.on_fields ? temp.size() : 0);
+	std::vector<REAL> heat_capacity(hooks.on_fields ? temp.size() : 0);
+	auto fill_property = [&](double (PropertyTable::*property)(double const) const, auto& field)
 	{
-		for (size_t i = 0; i < heat_capacity.size(); i++)
+		for (size_t index = 0; index < temp.size(); index++)
 		{
-			heat_capacity[i] = waples_heat_capacity(cf._specific_heat_capacity, temp[i]);
+			field[index] = static_cast<REAL>((property_table.*property)(property_temp[index]));
 		}
-	}
-	else
+	};
+
+	// chemistry: remaining fraction of each species (or amount of each species of a reaction network), and meshes
+	// for output
+	std::vector<ChemSpecies> chem_species_array = csv_file_data._chem_array;
+	ReactionNetwork const* network = csv_file_data._network.get();
+	std::vector<std::vector<double>> chem;
+	std::vector<M> chem_meshes;
+	if (CHEMISTRY_ON)
 	{
-		heat_capacity.fill(cf._specific_heat_capacity);
+		for (size_t species = 0; species < csv_file_data.number_of_species(); species++)
+		{
+			chem.push_back(std::vector<double>(temp.size(), network ? network->initial_amount(species) : 1.0));
+			chem_meshes.push_back(M(temp, hooks.output_prefix + "output_chem" + std::to_string(species + 1)));
+		}
 	}
 
-	M thermal_diffusivity(cf, "thermal_diffusivity");
-	if (not (cf._fixed_thermal_conductivity or cf._fixed_specific_heat_capacity))
+	// the full fields are written with field_output=true, and the summary (see RunSummary.h) with summary_output=true
+	bool const write_fields = hooks.write_files and cf._field_output;
+	std::unique_ptr<RunSummary> summary;
+	std::string const summary_path = cf.output_path(hooks.output_prefix + "summary.csv");
+	if (hooks.write_files and cf._summary_output)
 	{
-		// calculate thermal diffusivity
-		for (size_t i = 0; i < thermal_diffusivity.size(); i++)
+		// organic matter remaining: species weighted by their proportions, or the species a network's reactions use
+		std::vector<double> remaining_weights;
+		std::vector<std::string> species_names;
+		for (size_t field = 0; field < chem.size(); field++)
 		{
-			thermal_diffusivity[i] = thermal_conductivity[i] / (cf._rock_density * heat_capacity[i]);
+			if (network)
+			{
+				auto const& unreacting = network->unreacting_species();
+				bool const reacts = std::find(unreacting.begin(), unreacting.end(), field) == unreacting.end();
+				remaining_weights.push_back(reacts ? 1.0 : 0.0);
+				species_names.push_back(network->species_name(field));
+			}
+			else
+			{
+				remaining_weights.push_back(chem_species_array[field].proportion());
+			}
 		}
+		summary = std::make_unique<RunSummary>(summary_path,
+			temp.point_volumes(), temp.centre_point(), remaining_weights, species_names, cf.conversion_levels(),
+			cf._significant_digits);
 	}
-	else
+	// heat released by chemistry so far (in J), accumulated over the update
+	double heat_released = 0.0;
+
+	// virtual probes (see Probes.h), sampled from the start
+	std::unique_ptr<ProbeRecorder> probes;
+	std::string const probes_path = cf.output_path(hooks.output_prefix + "probes.csv");
+	std::vector<std::vector<double>> const probe_positions = cf.probe_positions();
+	if (hooks.write_files and not probe_positions.empty())
 	{
-		thermal_diffusivity.fill(
-			cf._thermal_conductivity / (cf._rock_density * cf._specific_heat_capacity));
+		std::vector<std::string> axes = { "x", "y", "z" };
+		if constexpr (not std::is_same_v<M, CuboidMesh>)
+		{
+			axes = std::is_same_v<M, SphereMesh> ? std::vector<std::string>{ "r" } : std::vector<std::string>{ "r", "z" };
+		}
+		std::vector<std::vector<std::pair<size_t, double>>> weights;
+		std::vector<std::string> names;
+		for (size_t probe = 0; probe < probe_positions.size(); probe++)
+		{
+			weights.push_back(temp.interpolation_weights(probe_positions[probe]));
+			if (weights.back().empty())
+			{
+				Log::error_write(log_file, "Probe " + std::to_string(probe + 1) + " isn't inside the particle.\n");
+			}
+			std::ostringstream name;
+			name << "Temperature (K) at";
+			for (size_t axis = 0; axis < axes.size(); axis++)
+			{
+				name << ' ' << axes[axis] << '=' << probe_positions[probe][axis];
+			}
+			names.push_back(name.str() + " microns");
+		}
+		probes = std::make_unique<ProbeRecorder>(probes_path, weights, names, cf._significant_digits);
+		probes->sample(0.0, temp.values());
 	}
+	size_t const probe_samples_per_second = cf._probe_samples_per_second;
 
-	// chemistry meshes
-	std::vector<ChemSpecies> chem_species_array = csv_file_data._chem_array;
-	std::vector<M> chem_meshes;
-	if (cf._chemistry_on)
+	// write the fields at time second to the output files, and hand them to the hooks
+	auto write_output = [&](size_t const second)
 	{
-		for (size_t species = 0; species < csv_file_data.number_of_species(); species++)
+		RunMetrics::Phase const phase = metrics ? metrics->enter_phase(RunMetrics::OUTPUT) : RunMetrics::OUTPUT;
+		if (write_fields)
 		{
-			chem_meshes.push_back(M(cf, "output_chem" + std::to_string(species + 1)));
-			chem_meshes[species].fill(1.0);
+			temp.write_files(second, cf._significant_digits);
+			if (not FIXED_HEAT_CAPACITY)
+			{
+				fill_property(&PropertyTable::heat_capacity, heat_capacity_mesh);
+				heat_capacity_mesh.write_files(second, cf._significant_digits);
+			}
+			if (not FIXED_THERMAL_CONDUCTIVITY)
+			{
+				fill_property(&PropertyTable::thermal_conductivity, thermal_conductivity_mesh);
+				thermal_conductivity_mesh.write_files(second, cf._significant_digits);
+			}
 		}
-	}
+		if (CHEMISTRY_ON and (write_fields or hooks.on_second))
+		{
+			for (size_t species = 0; species < chem.size(); species++)
+			{
+				copy_to_mesh(chem[species], chem_meshes[species]);
+				if (write_fields)
+				{
+					chem_meshes[species].write_files(second, cf._significant_digits);
+				}
+			}
+		}
+		if (hooks.on_second)
+		{
+			hooks.on_second(second, temp, chem_meshes);
+		}
+		if (hooks.on_fields or summary)
+		{
+			if (hooks.on_fields)
+			{
+				fill_property(&PropertyTable::heat_capacity, heat_capacity);
+				fill_property(&PropertyTable::thermal_conductivity, thermal_conductivity);
+			}
+			SolverFields fields;
+			fields.temp = FieldView(temp.values());
+			fields.heat_capacity = FieldView(heat_capacity);
+			fields.thermal_conductivity = FieldView(thermal_conductivity);
+			for (auto const& field : chem)
+			{
+				fields.chem.push_back(FieldView(field));
+			}
+			if (summary)
+			{
+				summary->write(second, fields.temp, fields.chem, heat_released);
+			}
+			if (hooks.on_fields)
+			{
+				hooks.on_fields(second, temp, fields);
+			}
+		}
+		if (probes)
+		{
+			probes->write();
+		}
+		if (metrics)
+		{
+			metrics->enter_phase(phase);
+		}
+	};
 
 	/*
 	Set up files for logging of output and write initial state to them
@@ -79,367 +304,715 @@ void heateqn_solver(ConfFileData& cf, CSVFileData& csv_file_data, std::ofstream&
 
 	Log::write(log_file, "Mesh initiailisations successful.\n");
 
-	temp.setup_files();
-	temp.write_files(0, cf._significant_digits);
-
-	if (not cf._fixed_specific_heat_capacity)
-	{
-		heat_capacity.setup_files();
-		heat_capacity.write_files(0, cf._significant_digits);
-	}
-
-	if (not cf._fixed_thermal_conductivity)
+	if (write_fields)
 	{
-		thermal_conductivity.setup_files();
-		thermal_conductivity.write_files(0, cf._significant_digits);
+		temp.setup_files();
+		if (not FIXED_HEAT_CAPACITY)
+		{
+			heat_capacity_mesh.setup_files();
+		}
+		if (not FIXED_THERMAL_CONDUCTIVITY)
+		{
+			thermal_conductivity_mesh.setup_files();
+		}
+		if (CHEMISTRY_ON)
+		{
+			for (size_t species = 0; species < csv_file_data.number_of_species(); species++)
+			{
+				chem_meshes[species].setup_files();
+			}
+		}
 	}
-
-	if (cf._chemistry_on)
+	if (metrics)
 	{
-		for (size_t species = 0; species < csv_file_data.number_of_species(); species++)
+		// (fields that aren't written have no files)
+		metrics->add_output_files(temp.filenames());
+		metrics->add_output_files(heat_capacity_mesh.filenames());
+		metrics->add_output_files(thermal_conductivity_mesh.filenames());
+		for (auto const& chem_mesh : chem_meshes)
+		{
+			metrics->add_output_files(chem_mesh.filenames());
+		}
+		if (summary)
 		{
-			chem_meshes[species].setup_files();
-			chem_meshes[species].write_files(0, cf._significant_digits);
+			metrics->add_output_files({ summary_path });
+		}
+		if (probes)
+		{
+			metrics->add_output_files({ probes_path });
 		}
 	}
-	Log::write(log_file, "Mesh files created and written to successfully.\n");
+	write_output(0);
+	if (write_fields)
+	{
+		Log::write(log_file, "Mesh files created and written to successfully.\n");
+	}
 
 	/*
-	Set up for heating time loop
+	Set up for time loop
 	*/
 	auto clock_start = std::chrono::steady_clock::now();
 
+	// Choose or check timesteps_per_second
+	plan_timesteps_per_second(cf, chem_species_array, property_table, temp, log_file);
+
 	// Calculate time_meshsize
-	size_t time_meshsize = cf._heating_time * cf._timesteps_per_second;
-	if (cf._fixed_max_temperature)
+	size_t time_meshsize = cf.heating_timesteps();
+	// Calculate timestep duration
+	size_t steps_per_second = cf._timesteps_per_second;
+	double dt = 1.0 / steps_per_second;
+
+	// Make new spare arrays for calculations
+	M new_temp(temp, hooks.output_prefix + "new_temp");
+	std::vector<std::vector<double>> new_chem = chem;
+
+	// Snapshot of the last good state (taken at the start of every second) to roll back to on divergence
+	M snapshot_temp = temp;
+	std::vector<REAL> snapshot_thermal_diffusivity = thermal_diffusivity;
+	std::vector<REAL> snapshot_property_temp = property_temp;
+	std::vector<std::vector<double>> snapshot_chem = chem;
+	size_t snapshot_heating_steps_remaining = 0;
+	bool snapshot_cooling_started = false;
+	double snapshot_heat_released = 0.0;
+	size_t timestep_reductions = 0;
+
+	// useful variables, copied out of cf so the compiler can keep them in registers in the update kernel
+	size_t mesh_size = temp.size();
+	const size_t number_of_species = csv_file_data.number_of_species();
+	const double heating_rate_per_second = cf._heating_rate / 60;
+	const double property_refresh_threshold = cf._property_refresh_threshold;
+	const double fixed_thermal_diffusivity = property_table.thermal_diffusivity(cf._initial_temp + 273.15);
+	const bool deterministic = cf._deterministic_reductions;
+	// points handed out to the threads at a time by the update loops, if auto_tune chooses to (see AutoTune.h)
+	size_t chunk_size = 0;
+
+	// heat released per unit of conversion of each species, or of each reaction of a network (J/m^3)
+	std::vector<double> species_heat(chem_species_array.size());
+	for (size_t species = 0; species < chem_species_array.size(); species++)
 	{
-		size_t timesteps_to_reach_max = 
-			static_cast<size_t>(((cf._max_temp - cf._initial_temp) / (cf._heating_rate / 60)) * cf._timesteps_per_second) + 1;
-		if (timesteps_to_reach_max < time_meshsize)
+		species_heat[species] = chem_species_array[species].alpha() * (cf._TOC / 100) * cf._kerogen_density;
+	}
+	ChemKinetics kinetics(chem_species_array);
+	if (CHEMISTRY_ON and kinetics.number_of_ladders() < chem_species_array.size())
+	{
+		Log::write(log_file, "Rate constants of the " + std::to_string(chem_species_array.size())
+			+ (network ? " reactions" : " species") + " are evaluated in "
+			+ std::to_string(kinetics.number_of_ladders()) + " groups sharing A with equally spaced Ea.\n");
+	}
+	bool const independent_network = network and network->independent();
+	if (CHEMISTRY_ON and network)
+	{
+		Log::write(log_file, "Reaction network of " + std::to_string(network->number_of_species()) + " species and "
+			+ std::to_string(network->number_of_reactions()) + " reactions"
+			+ (independent_network ? ", which are independent.\n" : ".\n"));
+	}
+
+	/*
+	Activity masking: a timestep changes a species by about k dt of what remains of it, so the chemistry is skipped
+	at points colder than cold_temp, below which k dt < chemistry_skip_tolerance for every species (found again
+	each second, as the timestep may have changed), and species whose remaining fraction has fallen below the
+	tolerance everywhere are dropped from the update (except for reaction networks, whose species feed each other)
+	*/
+	double const skip_tolerance = CHEMISTRY_ON ? cf._chemistry_skip_tolerance : 0.0;
+	std::vector<bool> species_active(chem_species_array.size(), true);
+	// the chemistry fields a timestep can change
+	std::vector<size_t> changing_fields;
+	for (size_t field = 0; field < chem.size(); field++)
+	{
+		changing_fields.push_back(field);
+	}
+	auto cold_temperature = [&]()
+	{
+		double cold_temp = (skip_tolerance > 0) ? INFINITY : 0.0;
+		for (size_t species = 0; species < chem_species_array.size() and skip_tolerance > 0; species++)
 		{
-			time_meshsize = timesteps_to_reach_max;
+			if (species_active[species])
+			{
+				cold_temp = std::min(cold_temp, chem_species_array[species].temperature_for_k(skip_tolerance / dt));
+			}
 		}
+		return cold_temp;
+	};
+	if (CHEMISTRY_ON and skip_tolerance > 0)
+	{
+		std::ostringstream message;
+		message << "Chemistry is skipped where k dt < chemistry_skip_tolerance=" << skip_tolerance
+			<< " for every species (below " << cold_temperature() - 273.15 << " C at the first timestep)"
+			<< (network ? "" : ", and for species depleted below it everywhere") << ".\n";
+		Log::write(log_file, message.str());
 	}
-	// Calculate timestep duration
-	double dt = 1.0 / cf._timesteps_per_second;
 
-	// Make new spare arrays for calculations
-	M new_temp = temp;
-	M new_heat_capacity = heat_capacity;
-	M new_thermal_conductivity = thermal_conductivity;
-	M new_thermal_diffusivity = thermal_diffusivity;
-	std::vector<M> new_chem_meshes;
-	if (cf._chemistry_on)
+	// advance an independent reaction network at a point one reaction at a time, as for independent species,
+	// returning the heat released by chemistry
+	auto react_independent = [&](size_t const index, double const point_temp, bool const implicit_step)
 	{
-		for (size_t species = 0; species < csv_file_data.number_of_species(); species++)
+		for (size_t const species : network->unreacting_species())
+		{
+			new_chem[species][index] = chem[species][index];
+		}
+		double chem_heat = 0.0;
+		kinetics.for_each_k(point_temp, [&](size_t const reaction, double const k)
+		{
+			size_t const species = network->reactant(reaction);
+			double const coefficient = network->reactant_coefficient(reaction);
+			double const amount = chem[species][index];
+			double const rate = implicit_step ? -amount * std::expm1(-coefficient * k * dt) / (coefficient * dt)
+				: k * amount;
+			new_chem[species][index] = amount - coefficient * dt * rate;
+			network->for_each_product(reaction, [&](size_t const product, double const product_coefficient)
+			{
+				new_chem[product][index] += product_coefficient * dt * rate;
+			});
+			chem_heat -= species_heat[reaction] * rate;
+		});
+		return chem_heat;
+	};
+
+	// advance every species of a reaction network at a point together, returning the heat released by chemistry
+	auto react_network = [&](size_t const index, double const point_temp, bool const implicit_step)
+	{
+		thread_local std::vector<double> amounts, new_amounts, k, extents;
+		amounts.resize(number_of_species);
+		new_amounts.resize(number_of_species);
+		k.resize(chem_species_array.size());
+		extents.resize(chem_species_array.size());
+		for (size_t species = 0; species < number_of_species; species++)
+		{
+			amounts[species] = chem[species][index];
+		}
+		kinetics.for_each_k(point_temp, [&](size_t const reaction, double const reaction_k) { k[reaction] = reaction_k; });
+		network->advance(amounts.data(), k.data(), dt, implicit_step, new_amounts.data(), extents.data());
+		double chem_heat = 0.0;
+		for (size_t species = 0; species < number_of_species; species++)
 		{
-			new_chem_meshes.push_back(chem_meshes[species]);
+			new_chem[species][index] = new_amounts[species];
+		}
+		for (size_t reaction = 0; reaction < extents.size(); reaction++)
+		{
+			chem_heat -= species_heat[reaction] * extents[reaction];
+		}
+		return chem_heat / dt;
+	};
+
+	// implicit timesteps, taken throughout with time_integration="implicit" and during the cooling phase with
+	// large_step_cooling=true: right hand side and inverse diffusivity of the linear system at each point
+	// (see LinearSolver.h), solved by multigrid on the cuboid and BiCGSTAB on the sphere and cylinder
+	using ImplicitSolver = std::conditional_t<std::is_same_v<M, CuboidMesh>, CuboidLinearSolver, BiCGSTABSolver<M>>;
+	bool const implicit = (cf._time_integration == "implicit");
+	// (multigrid needs the symmetric second-order Laplace operator of the cuboid)
+	bool const large_step_cooling = cf._cooling_phase and cf._large_step_cooling and not implicit
+		and not (std::is_same_v<M, CuboidMesh> and cf._spatial_order == 4);
+	bool large_steps = false;
+	std::vector<double> implicit_rhs;
+	std::vector<double> inverse_diffusivity;
+	std::unique_ptr<ImplicitSolver> linear_solver;
+	if (implicit or large_step_cooling)
+	{
+		implicit_rhs.resize(mesh_size, 0.0);
+		inverse_diffusivity.resize(mesh_size, 0.0);
+		linear_solver = std::make_unique<ImplicitSolver>(cf);
+		if constexpr (std::is_same_v<M, CuboidMesh>)
+		{
+			Log::write(log_file, "Implicit timesteps use linear_solver=" + cf._linear_solver + " with "
+				+ std::to_string(linear_solver->number_of_levels()) + " multigrid level(s).\n");
+		}
+		else
+		{
+			Log::write(log_file, "Implicit timesteps use BiCGSTAB.\n");
 		}
 	}
 
-	// useful variables
-	double chem_heat = 0.0;
-	size_t mesh_size = temp.size();
-	const size_t write_frequency = cf._timesteps_per_second;
-	const size_t number_of_species = csv_file_data.number_of_species();
+	// the steady state of the cooling phase, once chemistry has stopped, is the boundary temperature everywhere
+	size_t const boundary_index = temp.boundary_points()[0];
 
-	/*
-	Heating loop
-	*/
-	Log::write(log_file, "Beginning heating loop.\n");
-	for (size_t timestep = 1; timestep < time_meshsize + 1; timestep++)
+	// the update loops run over the interior and boundary points separately
+	std::vector<size_t> const& interior_points = temp.interior_points();
+	std::vector<size_t> const& boundary_points = temp.boundary_points();
+	// volume of the particle each point stands for, to add up the heat released by chemistry
+	std::vector<double> const& volumes = temp.point_volumes();
+
+	// recalculate the thermal diffusivity once the temperature at a point has drifted far enough
+	// (it only depends on temperature at this point, so can be updated in place)
+	auto refresh_properties = [&](size_t const index)
 	{
-		// loop over points in mesh
-#pragma omp parallel for
-		for (size_t index = 0; index < mesh_size; index++)
+		if constexpr (VARIABLE_PROPERTIES)
 		{
-			if (not temp.is_on_boundary(index))
+			if (std::abs(new_temp[index] - property_temp[index]) > property_refresh_threshold)
 			{
-				// calculate heat from chemistry at this point
-				chem_heat = 0.0;
-				if (cf._chemistry_on)
-				{
-					for (size_t species = 0; species < number_of_species; species++)
-					{
-						chem_heat -=
-							(chem_species_array[species].alpha() * (cf._TOC / 100) * cf._kerogen_density)
-							* chem_species_array[species].k(temp[index]) * chem_meshes[species][index];
-					}
-				}
+				thermal_diffusivity[index] = static_cast<REAL>(property_table.thermal_diffusivity(new_temp[index]));
+				property_temp[index] = static_cast<REAL>(new_temp[index]);
+			}
+		}
+	};
 
-				// use heat equation to calculate new_temp at interior points
-				new_temp[index] = temp[index] + thermal_diffusivity[index] * dt * temp.laplacian(index) + dt * chem_heat;
+	// update every point by a timestep, into new_temp and new_chem, returning the residual norms of the timestep and
+	// the heating by chemistry, accumulated as reductions over the update (see Reductions.h)
+	auto update_points = [&](double const boundary_increment, bool const implicit_step, double const cold_temp)
+	{
+		PointReductions totals;
 
-				// update thermodynamics arrays with new temps
-				if (not cf._fixed_specific_heat_capacity)
+		// refresh the properties at a point after its update and return its change in temperature
+		auto finish_point = [&](size_t const index, double const point_temp)
+		{
+			refresh_properties(index);
+			return new_temp[index] - point_temp;
+		};
+
+		// interior points: chemistry and the heat equation
+		totals.combine(reduce_over_points(interior_points.size(), deterministic, chunk_size,
+			[&](size_t const n, PointReductions& reductions)
+		{
+			size_t const index = interior_points[n];
+			double const point_temp = temp[index];
+
+			// calculate heat from chemistry at this point and update chem arrays
+			double chem_heat = 0.0;
+			if constexpr (CHEMISTRY_ON)
+			{
+				if (point_temp < cold_temp)
 				{
-					new_heat_capacity[index] = waples_heat_capacity(cf._specific_heat_capacity, temp[index]);
+					// too cold for any reaction this timestep
+					for (size_t const field : changing_fields)
+					{
+						new_chem[field][index] = chem[field][index];
+					}
 				}
-				if (not cf._fixed_thermal_conductivity)
+				else if (independent_network)
 				{
-					new_thermal_conductivity[index] = waples_thermal_conductivity(cf._thermal_conductivity, temp[index]);
+					chem_heat = react_independent(index, point_temp, implicit_step);
 				}
-				if (not cf._fixed_thermal_conductivity or not cf._fixed_specific_heat_capacity)
+				else if (network)
 				{
-					new_thermal_diffusivity[index] = new_thermal_conductivity[index] / (new_heat_capacity[index] * cf._rock_density);
+					chem_heat = react_network(index, point_temp, implicit_step);
 				}
-
-				// update chem arrays at interior points
-				if (cf._chemistry_on)
+				else
 				{
-					for (size_t species = 0; species < number_of_species; species++)
+					kinetics.for_each_k(point_temp, [&](size_t const species, double const k)
 					{
-						new_chem_meshes[species][index] = chem_meshes[species][index] -
-							dt * chem_species_array[species].k(temp[index]) * chem_meshes[species][index];
-					}
+						double const fraction = chem[species][index];
+						double const rate = implicit_step ? -fraction * std::expm1(-k * dt) / dt : k * fraction;
+						chem_heat -= species_heat[species] * rate;
+						new_chem[species][index] = fraction - dt * rate;
+					});
 				}
+				reductions.max_chem_heat = std::max(reductions.max_chem_heat, std::abs(chem_heat));
+				reductions.chem_power += volumes[index] * chem_heat;
+			}
+
+			// use heat equation to calculate new_temp at interior points
+			double const diffusivity = VARIABLE_PROPERTIES ? thermal_diffusivity[index] : fixed_thermal_diffusivity;
+			if (implicit_step)
+			{
+				// set up the backward Euler equations, starting the solve from the current temperature
+				inverse_diffusivity[index] = 1 / diffusivity;
+				implicit_rhs[index] = (point_temp + dt * chem_heat) / diffusivity;
+				new_temp[index] = point_temp;
 			}
 			else
 			{
-				// on boundary, apply boundary condition
-				new_temp[index] = temp[index] + (cf._heating_rate / 60) * dt;
+				new_temp[index] = point_temp + diffusivity * dt * temp.laplacian(index) + dt * chem_heat;
+
+				// accumulate residual norms and check the new temperature is finite
+				double const change = finish_point(index, point_temp);
+				reductions.max_change = std::max(reductions.max_change, std::abs(change));
+				reductions.sum_of_square_changes += change * change;
+				reductions.non_finite = reductions.non_finite or not std::isfinite(new_temp[index]);
+			}
+		}));
 
-				// update thermodynamic arrays on boundary
-				if (not cf._fixed_specific_heat_capacity)
+		// boundary points: apply boundary condition and update chem arrays (the heat released by chemistry only
+		// counts towards the total, as the boundary temperature is held to the heating ramp)
+		totals.combine(reduce_over_points(boundary_points.size(), deterministic, chunk_size,
+			[&](size_t const n, PointReductions& reductions)
+		{
+			size_t const index = boundary_points[n];
+			double const point_temp = temp[index];
+			new_temp[index] = point_temp + boundary_increment;
+			if constexpr (CHEMISTRY_ON)
+			{
+				if (point_temp < cold_temp)
 				{
-					new_heat_capacity[index] = waples_heat_capacity(cf._specific_heat_capacity, temp[index]);
+					for (size_t const field : changing_fields)
+					{
+						new_chem[field][index] = chem[field][index];
+					}
 				}
-				if (not cf._fixed_thermal_conductivity)
+				else if (independent_network)
 				{
-					new_thermal_conductivity[index] = waples_thermal_conductivity(cf._thermal_conductivity, temp[index]);
+					reductions.chem_power += volumes[index] * react_independent(index, point_temp, implicit_step);
 				}
-				if (not cf._fixed_thermal_conductivity or not cf._fixed_specific_heat_capacity)
+				else if (network)
 				{
-					new_thermal_diffusivity[index] = new_thermal_conductivity[index] / (new_heat_capacity[index] * cf._rock_density);
+					reductions.chem_power += volumes[index] * react_network(index, point_temp, implicit_step);
 				}
-
-				// update chemistry on boundary
-				if (cf._chemistry_on)
+				else
 				{
-					for (size_t species = 0; species < number_of_species; species++)
+					double chem_heat = 0.0;
+					kinetics.for_each_k(point_temp, [&](size_t const species, double const k)
 					{
-						new_chem_meshes[species][index] = chem_meshes[species][index] -
-							dt * chem_species_array[species].k(temp[index]) * chem_meshes[species][index];
-					}
+						double const fraction = chem[species][index];
+						new_chem[species][index] = implicit_step ? fraction * std::exp(-k * dt) : fraction - dt * k * fraction;
+						chem_heat -= species_heat[species] * (fraction - new_chem[species][index]) / dt;
+					});
+					reductions.chem_power += volumes[index] * chem_heat;
 				}
 			}
-		}
 
-		// copy arrays for next timestep
-		temp = new_temp;
-		if (not cf._fixed_specific_heat_capacity)
-		{
-			heat_capacity = new_heat_capacity;
-		}
-		if (not cf._fixed_thermal_conductivity)
-		{
-			thermal_conductivity = new_thermal_conductivity;
-		}
-		if (not cf._fixed_thermal_conductivity or not cf._fixed_specific_heat_capacity)
-		{
-			thermal_diffusivity = new_thermal_diffusivity;
-		}
-		if (cf._chemistry_on)
-		{
-			for (size_t species = 0; species < number_of_species; species++)
+			if (not implicit_step)
 			{
-				chem_meshes[species] = new_chem_meshes[species];
+				double const change = finish_point(index, point_temp);
+				reductions.max_change = std::max(reductions.max_change, std::abs(change));
+				reductions.sum_of_square_changes += change * change;
+				reductions.non_finite = reductions.non_finite or not std::isfinite(new_temp[index]);
 			}
-		}
+		}));
 
-		// if we've hit a round number of timesteps, write arrays to output files
-		if (timestep % write_frequency == 0)
+		// implicit timesteps solve for the new temperature at interior points, then finish as above
+		if (implicit_step)
 		{
-			size_t current_model_time_secs = timestep / cf._timesteps_per_second;
+			linear_solver->solve(new_temp, inverse_diffusivity, implicit_rhs, dt);
 
-			// check for divergence and raise error if we have diverged
-			if (temp.is_nan())
+			double const boundary_temp = new_temp[boundary_index];
+			totals.combine(reduce_over_points(mesh_size, deterministic, chunk_size,
+				[&](size_t const index, PointReductions& reductions)
 			{
-				Log::error_write(log_file, "Temperature field has diverged. Try increasing timesteps_per_second.\n");
-			}
+				refresh_properties(index);
 
-			// write to output files
-			temp.write_files(current_model_time_secs, cf._significant_digits);
-			if (not cf._fixed_specific_heat_capacity)
+				double const change = new_temp[index] - temp[index];
+				reductions.max_change = std::max(reductions.max_change, std::abs(change));
+				reductions.sum_of_square_changes += change * change;
+				reductions.non_finite = reductions.non_finite or not std::isfinite(new_temp[index]);
+				reductions.max_deviation = std::max(reductions.max_deviation,
+					std::abs(new_temp[index] - boundary_temp));
+			}));
+		}
+
+		return totals;
+	};
+
+	// choose how to run the update on the available threads (see AutoTune.h), timing the first timestep of the
+	// heating phase repeatedly unless the choice for this problem has been saved before (with the chemistry run at
+	// every point, as at the hot points that dominate the run, rather than skipped as it would be from cold)
+	if (cf._auto_tune)
+	{
+		std::string const key = tuning_key(cf, mesh_size, number_of_species);
+		ExecutionPlan plan;
+		if (read_cached_plan(cf._tuning_cache, key, plan))
+		{
+			Log::write(log_file, "Running the update on " + plan.description() + ", saved in " + cf._tuning_cache
+				+ ".\n");
+		}
+		else
+		{
+			std::vector<ExecutionPlan> const candidates = candidate_plans(mesh_size, deterministic);
+			Log::write_to_log_file(log_file, "Timing " + std::to_string(cf._tuning_timesteps)
+				+ " timesteps of the update with " + std::to_string(candidates.size()) + " plan(s):\n");
+			double const cold_temp = CHEMISTRY_ON ? -INFINITY : cold_temperature();
+			plan = fastest_plan(candidates, cf._tuning_timesteps, [&](ExecutionPlan const& candidate)
 			{
-				heat_capacity.write_files(current_model_time_secs, cf._significant_digits);
-			}
+				chunk_size = candidate.chunk_size;
+				update_points(heating_rate_per_second * dt, implicit, cold_temp);
+			}, log_file);
 
-			if (not cf._fixed_thermal_conductivity)
+			// the timesteps only wrote the new arrays and refreshed properties, so put the properties back (and start
+			// the linear solver's statistics again)
+			thermal_diffusivity = snapshot_thermal_diffusivity;
+			property_temp = snapshot_property_temp;
+			if (linear_solver)
 			{
-				thermal_conductivity.write_files(current_model_time_secs, cf._significant_digits);
+				linear_solver = std::make_unique<ImplicitSolver>(cf);
 			}
 
-			if (cf._chemistry_on)
+			Log::write(log_file, "Running the update on " + plan.description() + ", the fastest of "
+				+ std::to_string(candidates.size()) + " plan(s).\n");
+			if (not cf._tuning_cache.empty())
 			{
-				for (size_t species = 0; species < number_of_species; species++)
-				{
-					chem_meshes[species].write_files(current_model_time_secs, cf._significant_digits);
-				}
+				write_cached_plan(cf._tuning_cache, key, plan);
 			}
-
-			// write progress update to stdout
-			auto clock_tick = std::chrono::steady_clock::now();
-			std::chrono::duration<double> elapsed_seconds = clock_tick - clock_start;
-			Log::write_to_console(std::to_string(current_model_time_secs)
-				+ " seconds elapsed in simulation. "
-				+ "Time taken so far: "
-				+ std::to_string(elapsed_seconds.count())
-				+ " seconds.\n");
 		}
-	} 
+		apply_execution_plan(plan);
+		chunk_size = plan.chunk_size;
+	}
+
+	size_t heating_steps_remaining = time_meshsize;
+	size_t current_model_time_secs = 0;
+	bool cooling_started = false;
+	bool equilibrium_reached = false;
+
+	// progress for the metrics: timesteps taken (including any rolled back) and the reductions of the last one
+	size_t timesteps_taken = 0;
+	PointReductions last_totals;
+	auto progress = [&](double const simulated_seconds)
+	{
+		RunMetrics::Progress progress;
+		progress.simulated_seconds = simulated_seconds;
+		progress.timesteps = timesteps_taken;
+		progress.heating_seconds_remaining = heating_steps_remaining * dt;
+		progress.cooling = cooling_started;
+		progress.equilibrium_reached = equilibrium_reached;
+		progress.max_rate = last_totals.max_change / dt;
+		progress.rms_rate = std::sqrt(last_totals.sum_of_square_changes / mesh_size) / dt;
+		return progress;
+	};
 
 	/*
-	Begin cooling loop
+	Time loop
+	The heating phase runs for time_meshsize timesteps; if the cooling phase is on, the model then
+	continues with the boundary held fixed until the residual norms show the particle is in equilibrium.
+	Each pass of the outer loop advances the model by one second. If a timestep diverges, the model is
+	rolled back to the start of the second and the second is run again with half the timestep.
 	*/
-	if (cf._cooling_phase)
+	Log::write(log_file, "Beginning heating loop.\n");
+	while (heating_steps_remaining > 0 or (cf._cooling_phase and not equilibrium_reached))
 	{
-		Log::write(log_file, "Beginning cooling loop.\n");
-		bool equilibrium_reached = false;
+		// once heating is over, switch to large implicit steps for the rest of the cooling phase
+		// (unless the explicit timestep is already at least as long)
+		if (large_step_cooling and not large_steps and heating_steps_remaining == 0
+			and cf._cooling_timesteps_per_second < steps_per_second)
+		{
+			large_steps = true;
+			steps_per_second = cf._cooling_timesteps_per_second;
+			dt = 1.0 / steps_per_second;
+			Log::write(log_file, "Switching to implicit timesteps for the cooling phase, with "
+				+ std::to_string(steps_per_second) + " timesteps per second.\n");
+		}
 
-		for (size_t timestep = time_meshsize + 1; not equilibrium_reached; timestep++)
+		// drop species depleted everywhere, and find the temperature below which the chemistry is skipped
+		if (CHEMISTRY_ON and skip_tolerance > 0 and not network)
 		{
-			// loop over all points in meshes
-#pragma omp parallel for
-			for (size_t index = 0; index < mesh_size; index++)
+			size_t depleted = 0;
+			for (size_t species = 0; species < chem.size(); species++)
+			{
+				if (species_active[species] and *std::max_element(chem[species].begin(), chem[species].end()) < skip_tolerance)
+				{
+					// (both buffers keep the last values)
+					species_active[species] = false;
+					new_chem[species] = chem[species];
+					depleted++;
+				}
+			}
+			if (depleted > 0)
 			{
-				if (not temp.is_on_boundary(index))
+				kinetics = ChemKinetics(chem_species_array, species_active);
+				changing_fields.clear();
+				for (size_t species = 0; species < chem.size(); species++)
 				{
-					chem_heat = 0.0;
-					if (cf._chemistry_on)
+					if (species_active[species])
 					{
-						for (size_t species = 0; species < number_of_species; species++)
-						{
-							chem_heat -=
-								(chem_species_array[species].alpha() * (cf._TOC / 100) * cf._kerogen_density)
-								* chem_species_array[species].k(temp[index]) * chem_meshes[species][index];
-						}
+						changing_fields.push_back(species);
 					}
+				}
+				Log::write(log_file, std::to_string(depleted) + " species depleted below chemistry_skip_tolerance everywhere "
+					+ "dropped from the chemistry update after " + std::to_string(current_model_time_secs) + " seconds ("
+					+ std::to_string(changing_fields.size()) + " remain).\n");
+			}
+		}
+		double const cold_temp = cold_temperature();
 
-					// use heat equation to calculate new_temp at interior points
-					new_temp[index] = temp[index] + thermal_diffusivity[index] * dt * temp.laplacian(index) + dt * chem_heat;
+		// save the state at the start of this second
+		snapshot_temp.copy_values(temp);
+		snapshot_thermal_diffusivity = thermal_diffusivity;
+		snapshot_property_temp = property_temp;
+		snapshot_chem = chem;
+		snapshot_heating_steps_remaining = heating_steps_remaining;
+		snapshot_cooling_started = cooling_started;
+		snapshot_heat_released = heat_released;
 
-					// update thermodynamics arrays with new temps
-					if (not cf._fixed_specific_heat_capacity)
-					{
-						new_heat_capacity[index] = waples_heat_capacity(cf._specific_heat_capacity, temp[index]);
-					}
-					if (not cf._fixed_thermal_conductivity)
-					{
-						new_thermal_conductivity[index] = waples_thermal_conductivity(cf._thermal_conductivity, temp[index]);
-					}
-					if (not cf._fixed_thermal_conductivity or not cf._fixed_specific_heat_capacity)
-					{
-						new_thermal_diffusivity[index] = new_thermal_conductivity[index] / (new_heat_capacity[index] * cf._rock_density);
-					}
+		if (metrics)
+		{
+			metrics->enter_phase((heating_steps_remaining > 0) ? RunMetrics::HEATING : RunMetrics::COOLING);
+		}
 
-					// update chem arrays at interior points
-					if (cf._chemistry_on)
-					{
-						for (size_t species = 0; species < number_of_species; species++)
-						{
-							new_chem_meshes[species][index] = chem_meshes[species][index] -
-								dt * chem_species_array[species].k(temp[index]) * chem_meshes[species][index];
-						}
-					}
-				}
-				else
+		bool diverged = false;
+		bool second_completed = true;
+		for (size_t step = 1; step <= steps_per_second; step++)
+		{
+			bool const heating = (heating_steps_remaining > 0);
+			if (not heating and not cf._cooling_phase)
+			{
+				// heating stopped part way through this second and there's no cooling phase
+				second_completed = false;
+				break;
+			}
+			if (not heating and not cooling_started)
+			{
+				Log::write(log_file, "Beginning cooling loop.\n");
+				cooling_started = true;
+				if (metrics)
 				{
-					// on the boundary, apply boundary conditions
-					new_temp[index] = temp[index];
+					metrics->enter_phase(RunMetrics::COOLING);
+				}
+			}
 
-					// update thermodynamic arrays on boundary
-					if (not cf._fixed_specific_heat_capacity)
-					{
-						new_heat_capacity[index] = waples_heat_capacity(cf._specific_heat_capacity, temp[index]);
-					}
-					if (not cf._fixed_thermal_conductivity)
-					{
-						new_thermal_conductivity[index] = waples_thermal_conductivity(cf._thermal_conductivity, temp[index]);
-					}
-					if (not cf._fixed_thermal_conductivity or not cf._fixed_specific_heat_capacity)
-					{
-						new_thermal_diffusivity[index] = new_thermal_conductivity[index] / (new_heat_capacity[index] * cf._rock_density);
-					}
+			// boundary temperature rises while heating and is held fixed while cooling
+			double const boundary_increment = heating ? heating_rate_per_second * dt : 0.0;
 
-					// update chemistry on boundary
-					if (cf._chemistry_on)
-					{
-						for (size_t species = 0; species < number_of_species; species++)
-						{
-							new_chem_meshes[species][index] = chem_meshes[species][index] -
-								dt * chem_species_array[species].k(temp[index]) * chem_meshes[species][index];
-						}
-					}
-				}
+			// implicit timesteps integrate the chemistry exponentially (a network that isn't independent by backward
+			// Euler), so that it stays stable for any timestep
+			bool const implicit_step = implicit or large_steps;
+
+			// residual norms of this timestep and the heating by chemistry
+			PointReductions const totals = update_points(boundary_increment, implicit_step, cold_temp);
+
+			// an unstable timestep shows up as a non-finite value or an implausibly fast change in temperature
+			if (totals.non_finite or totals.max_change / dt > cf._divergence_max_rate)
+			{
+				diverged = true;
+				break;
+			}
+
+			// swap arrays for next timestep (every value of the new arrays is overwritten each timestep)
+			temp.swap_values(new_temp);
+			if (CHEMISTRY_ON)
+			{
+				chem.swap(new_chem);
+				heat_released += totals.chem_power * dt;
+			}
+
+			// sample the probes at the first timestep to reach each of the probe_samples_per_second sampling times
+			if (probes and (step * probe_samples_per_second) / steps_per_second
+				!= ((step - 1) * probe_samples_per_second) / steps_per_second)
+			{
+				probes->sample(current_model_time_secs + step * dt, temp.values());
+			}
+
+			// (the metrics only look at the clock every 100 timesteps, to keep it out of small meshes' timesteps)
+			timesteps_taken++;
+			last_totals = totals;
+			if (metrics and step % 100 == 0)
+			{
+				metrics->update(progress(current_model_time_secs + step * dt));
 			}
 
-			// copy arrays for next timestep
-			temp = new_temp;
-			if (not cf._fixed_specific_heat_capacity)
+			if (heating)
 			{
-				heat_capacity = new_heat_capacity;
+				heating_steps_remaining--;
 			}
-			if (not cf._fixed_thermal_conductivity)
+			else if (equilibrium_reached)
 			{
-				thermal_conductivity = new_thermal_conductivity;
+				// finish the second, so that the field written out is the state at its end
 			}
-			if (not cf._fixed_thermal_conductivity or not cf._fixed_specific_heat_capacity)
+			else if (large_steps and totals.max_chem_heat < cf._equilibrium_max_rate
+				and totals.max_deviation < cf._equilibrium_max_rate)
 			{
-				thermal_diffusivity = new_thermal_diffusivity;
+				// chemistry has stopped and the temperature is everywhere closer to the steady state than the
+				// equilibrium tolerance would allow it to move in a second, so jump straight to the steady state
+				temp.fill(temp[boundary_index]);
+				// the properties follow the jump, so the property fields written out are those of the steady state
+				if constexpr (VARIABLE_PROPERTIES)
+				{
+					std::fill(property_temp.begin(), property_temp.end(), static_cast<REAL>(temp[boundary_index]));
+					std::fill(thermal_diffusivity.begin(), thermal_diffusivity.end(),
+						static_cast<REAL>(property_table.thermal_diffusivity(temp[boundary_index])));
+				}
+				equilibrium_reached = true;
+				Log::write(log_file, "Chemistry has stopped; jumped to the steady state after "
+					+ std::to_string(current_model_time_secs + step * dt)
+					+ " seconds of simulated time.\n");
 			}
-			if (cf._chemistry_on)
+			else
 			{
-				for (size_t species = 0; species < csv_file_data.number_of_species(); species++)
+				// while cooling, compare the rates of change of temperature against the equilibrium tolerances
+				double const max_rate = totals.max_change / dt;
+				double const rms_rate = std::sqrt(totals.sum_of_square_changes / mesh_size) / dt;
+				equilibrium_reached = (max_rate < cf._equilibrium_max_rate) and (rms_rate < cf._equilibrium_rms_rate);
+				if (equilibrium_reached)
 				{
-					chem_meshes[species] = new_chem_meshes[species];
+					Log::write(log_file, "Equilibrium reached after "
+						+ std::to_string(current_model_time_secs + step * dt)
+						+ " seconds of simulated time.\n");
 				}
 			}
+		}
 
-			// if we've hit a round number of timesteps, check for equilibrium and write arrays to output files
-			if (timestep % write_frequency == 0)
+		if (diverged)
+		{
+			// give up if the timestep has already been reduced too many times
+			if (timestep_reductions == cf._max_timestep_reductions)
 			{
-				equilibrium_reached = temp.nearly_equal(new_temp);
+				Log::error_write(log_file, "Temperature field has diverged during second "
+					+ std::to_string(current_model_time_secs + 1) + " with timesteps_per_second="
+					+ std::to_string(steps_per_second) + ". Try increasing timesteps_per_second.\n");
+			}
 
-				size_t current_model_time_secs = timestep / cf._timesteps_per_second;
+			// roll back to the start of this second
+			temp.copy_values(snapshot_temp);
+			thermal_diffusivity = snapshot_thermal_diffusivity;
+			property_temp = snapshot_property_temp;
+			chem = snapshot_chem;
+			heating_steps_remaining = snapshot_heating_steps_remaining;
+			cooling_started = snapshot_cooling_started;
+			heat_released = snapshot_heat_released;
+			if (probes)
+			{
+				probes->discard();
+			}
 
-				// check for divergence and raise error if we have diverged
-				if (temp.is_nan())
-				{
-					Log::error_write(log_file, "Temperature field has diverged. Try increasing timesteps_per_second.\n");
-				}
+			// halve the timestep; the remaining heating time is now twice as many timesteps
+			steps_per_second *= 2;
+			heating_steps_remaining *= 2;
+			dt = 1.0 / steps_per_second;
+			timestep_reductions++;
 
-				// write to output files
-				temp.write_files(current_model_time_secs, cf._significant_digits);
-				if (not cf._fixed_specific_heat_capacity)
-				{
-					heat_capacity.write_files(current_model_time_secs, cf._significant_digits);
-				}
+			Log::write(log_file, "Temperature field diverged during second " + std::to_string(current_model_time_secs + 1)
+				+ ". Rolled back to " + std::to_string(current_model_time_secs) + " seconds and increased "
+				+ "timesteps_per_second to " + std::to_string(steps_per_second) + ".\n");
+			continue;
+		}
 
-				if (not cf._fixed_thermal_conductivity)
-				{
-					thermal_conductivity.write_files(current_model_time_secs, cf._significant_digits);
-				}
+		if (not second_completed)
+		{
+			break;
+		}
 
-				if (cf._chemistry_on)
-				{
-					for (size_t species = 0; species < csv_file_data.number_of_species(); species++)
-					{
-						chem_meshes[species].write_files(current_model_time_secs, cf._significant_digits);
-					}
-				}
+		// a second has been completed (a run that reaches equilibrium part way through a second still finishes it),
+		// so write arrays to output files
+		current_model_time_secs++;
 
-				// write progress update to stdout
-				auto clock_tick = std::chrono::steady_clock::now();
-				std::chrono::duration<double> elapsed_seconds = clock_tick - clock_start;
-				Log::write_to_console(std::to_string(current_model_time_secs)
-					+ " seconds elapsed in simulation. "
-					+ "Time taken so far: "
-					+ std::to_string(elapsed_seconds.count())
-					+ " seconds.\n");				
-			}
-			
+		// write to output files
+		write_output(current_model_time_secs);
+		if (metrics)
+		{
+			metrics->update(progress(current_model_time_secs));
 		}
+
+		// write progress update to stdout
+		auto clock_tick = std::chrono::steady_clock::now();
+		std::chrono::duration<double> elapsed_seconds = clock_tick - clock_start;
+		Log::write_to_console(std::to_string(current_model_time_secs)
+			+ " seconds elapsed in simulation. "
+			+ "Time taken so far: "
+			+ std::to_string(elapsed_seconds.count())
+			+ " seconds.\n");
+	}
+
+	if (linear_solver)
+	{
+		Log::write(log_file, linear_solver->statistics() + '\n');
+	}
+
+	// (samples from the part of a second left when heating stops without a cooling phase)
+	if (probes)
+	{
+		probes->write();
+	}
+
+	if (summary and CHEMISTRY_ON)
+	{
+		Log::write(log_file, summary->conversion_times());
+	}
+
+	if (timestep_reductions > 0)
+	{
+		Log::write(log_file, "The timestep was reduced " + std::to_string(timestep_reductions)
+			+ " time(s) to keep the model stable. Consider setting timesteps_per_second="
+			+ std::to_string(steps_per_second) + " for future runs.\n");
+	}
+
+	if (metrics)
+	{
+		metrics->enter_phase(RunMetrics::OUTPUT);
+		metrics->update(progress(current_model_time_secs), true);
 	}
 
 	// simulation completed
@@ -448,7 +1021,80 @@ void heateqn_solver(ConfFileData& cf, CSVFileData& csv_file_data, std::ofstream&
 	Log::write(log_file, "Simulation completed. Time elapsed: " + std::to_string(elapsed_seconds.count()) + " seconds.\n");
 }
 
-// to keep the linker happy, need to instantiate concrete versions of the template function
-template void heateqn_solver<SphereMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
-template void heateqn_solver<CylinderMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
-template void heateqn_solver<CuboidMesh>(ConfFileData&, CSVFileData&, std::ofstream&);
+// pick the variant of the solver compiled for the fixed property settings
+template <typename M, typename REAL, bool CHEMISTRY_ON>
+void heateqn_solver_dispatch_properties(ConfFileData& cf, CSVFileData& csv_file_data, std::ofstream& log_file,
+	SolverHooks<M> const& hooks)
+{
+	if (cf._fixed_specific_heat_capacity and cf._fixed_thermal_conductivity)
+	{
+		heateqn_solver_variant<M, REAL, CHEMISTRY_ON, true, true>(cf, csv_file_data, log_file, hooks);
+	}
+	else if (cf._fixed_specific_heat_capacity)
+	{
+		heateqn_solver_variant<M, REAL, CHEMISTRY_ON, true, false>(cf, csv_file_data, log_file, hooks);
+	}
+	else if (cf._fixed_thermal_conductivity)
+	{
+		heateqn_solver_variant<M, REAL, CHEMISTRY_ON, false, true>(cf, csv_file_data, log_file, hooks);
+	}
+	else
+	{
+		heateqn_solver_variant<M, REAL, CHEMISTRY_ON, false, false>(cf, csv_file_data, log_file, hooks);
+	}
+}
+
+template <typename M, typename REAL>
+void heateqn_solver_dispatch_chemistry(ConfFileData& cf, CSVFileData& csv_file_data, std::ofstream& log_file,
+	SolverHooks<M> const& hooks)
+{
+	if (cf._chemistry_on)
+	{
+		heateqn_solver_dispatch_properties<M, REAL, true>(cf, csv_file_data, log_file, hooks);
+	}
+	else
+	{
+		heateqn_solver_dispatch_properties<M, REAL, false>(cf, csv_file_data, log_file, hooks);
+	}
+}
+
+template <typename M>
+void heateqn_solver(ConfFileData& cf, CSVFileData& csv_file_data, std::ofstream& log_file,
+	SolverHooks<M> const& hooks)
+{
+#ifdef _OPENMP
+	// hooks.threads and auto_tune only set the thread count of the calling thread for the run, so (for the next
+	// job of a server worker, say) it is put back however the run ends
+	struct ThreadCountRestorer
+	{
+		int const threads = omp_get_max_threads();
+		~ThreadCountRestorer()
+		{
+			omp_set_num_threads(threads);
+		}
+	} const thread_count_restorer;
+	if (hooks.threads > 0)
+	{
+		omp_set_num_threads(static_cast<int>(hooks.threads));
+	}
+#endif
+	if (cf._mixed_precision)
+	{
+		heateqn_solver_dispatch_chemistry<M, float>(cf, csv_file_data, log_file, hooks);
+	}
+	else
+	{
+		heateqn_solver_dispatch_chemistry<M, double>(cf, csv_file_data, log_file, hooks);
+	}
+}
+
+// to keep the linker happy, need to instantiate concrete versions of the template functions
+template void plan_timesteps_per_second<SphereMesh>(ConfFileData&, std::vector<ChemSpecies>&, PropertyTable const&,
+	SphereMesh const&, std::ofstream&);
+template void plan_timesteps_per_second<CylinderMesh>(ConfFileData&, std::vector<ChemSpecies>&, PropertyTable const&,
+	CylinderMesh const&, std::ofstream&);
+template void plan_timesteps_per_second<CuboidMesh>(ConfFileData&, std::vector<ChemSpecies>&, PropertyTable const&,
+	CuboidMesh const&, std::ofstream&);
+template void heateqn_solver<SphereMesh>(ConfFileData&, CSVFileData&, std::ofstream&, SolverHooks<SphereMesh> const&);
+template void heateqn_solver<CylinderMesh>(ConfFileData&, CSVFileData&, std::ofstream&, SolverHooks<CylinderMesh> const&);
+template void heateqn_solver<CuboidMesh>(ConfFileData&, CSVFileData&, std::ofstream&, SolverHooks<CuboidMesh> const&);
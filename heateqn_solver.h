@@ -1,5 +1,69 @@
 #pragma once
 #include "ConfFileData.h"
 #include "CSVFileData.h"
+#include "ChemSpecies.h"
+#include "PropertyTable.h"
+#include <vector>
+#include <string>
+#include <functional>
+
+// Read-only view of one of the solver's fields, without copying it, whether it is stored as double or as float
+// (with mixed_precision=true)
+class FieldView
+{
+private:
+	double const* _double_data = nullptr;
+	float const* _float_data = nullptr;
+	size_t _size = 0;
+
+public:
+	FieldView() = default;
+	FieldView(std::vector<double> const& field);
+	FieldView(std::vector<float> const& field);
+
+	double operator[](size_t const index) const
+	{
+		return _double_data ? _double_data[index] : static_cast<double>(_float_data[index]);
+	}
+	size_t size() const;
+	// the values, if stored as double (otherwise nullptr)
+	double const* double_data() const;
+	// the values, if stored as float (otherwise nullptr)
+	float const* float_data() const;
+};
+
+// Views of every field of the solver at one second, indexed like the points of the temperature mesh
+struct SolverFields
+{
+	FieldView temp;
+	FieldView heat_capacity;
+	FieldView thermal_conductivity;
+	// remaining fraction of each species (none with chemistry_on=false)
+	std::vector<FieldView> chem;
+};
+
+// Optional hooks for running the solver as part of a larger calculation (see Richardson.h and SolverSession.h)
 template <typename T>
-void heateqn_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file);
\ No newline at end of file
+struct SolverHooks
+{
+	// prepended to the names of the output files
+	std::string output_prefix;
+	// whether to write the output files
+	bool write_files = true;
+	// property tables to use instead of building them
+	PropertyTable const* property_table = nullptr;
+	// called with the solution at the end of every output second (and at 0 seconds)
+	std::function<void(size_t const second, T const& temp, std::vector<T> const& chem_meshes)> on_second;
+	// called at the same times with views of the solver's own fields, which stay unchanged until it returns
+	std::function<void(size_t const second, T const& temp, SolverFields const& fields)> on_fields;
+	// number of OpenMP threads to run on (0 to leave it as it is), set for the thread calling the solver while it runs
+	size_t threads = 0;
+};
+
+template <typename T>
+void heateqn_solver(ConfFileData& conf_file_data, CSVFileData& csv_file_data, std::ofstream& log_file,
+	SolverHooks<T> const& hooks = SolverHooks<T>());
+// Choose timesteps_per_second (if auto_timestep=true) or check it against the stability limit for mesh
+template <typename T>
+void plan_timesteps_per_second(ConfFileData& conf_file_data, std::vector<ChemSpecies>& chem_species_array,
+	PropertyTable const& property_table, T const& mesh, std::ofstream& log_file);
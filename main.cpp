@@ -2,18 +2,35 @@
 #include "CSVFileData.h"
 #include "test.h"
 #include "Log.h"
-#include "heateqn_solver.h"
-#include "Mesh.h"
+#include "Server.h"
+#include "Simulation.h"
 #include <fstream>
+#include <string>
+#include <vector>
 
-int main()
+int main(int argc, char* argv[])
 {
+	// heateqn_with_chemistry --server runs jobs sent to it instead of settings.conf (see Server.h)
+	if (argc > 1 and std::string(argv[1]) == "--server")
+	{
+		return run_server(std::vector<std::string>(argv + 2, argv + argc));
+	}
+
+	// heateqn_with_chemistry --test runs the checks in test.cpp, logging to test_log.txt, and fails if any fails
+	if (argc > 1 and std::string(argv[1]) == "--test")
+	{
+		std::ofstream log_file("test_log.txt");
+		bool const passed = amr_conservation_test(log_file);
+		return passed ? 0 : 1;
+	}
+
 	// Read in file data
 	ConfFileData conf_file_data("settings.conf");
 	CSVFileData csv_file_data(conf_file_data._chemistry_file);
 
 	// Set up log file and dump conf_file_data to log
-	std::ofstream log_file(conf_file_data._log_filename);
+	conf_file_data.create_output_directory();
+	std::ofstream log_file(conf_file_data.output_path(conf_file_data._log_filename));
 	Log::write(log_file, "settings.conf and " + conf_file_data._chemistry_file + " read successfully.\n");
 	Log::write_to_console("Writing read-in settings to log file: " + conf_file_data._log_filename + '\n');
 	conf_file_data.log_input(log_file);
@@ -22,18 +39,7 @@ int main()
 	conf_file_data.check_input(log_file);
 
 	// Run simulation
-	if (conf_file_data._geometry == 1)
-	{
-		heateqn_solver<SphereMesh>(conf_file_data, csv_file_data, log_file);
-	}
-	else if (conf_file_data._geometry == 2)
-	{
-		heateqn_solver<CylinderMesh>(conf_file_data, csv_file_data, log_file);
-	}
-	else if (conf_file_data._geometry == 3)
-	{
-		heateqn_solver<CuboidMesh>(conf_file_data, csv_file_data, log_file);
-	}
+	run_simulation(conf_file_data, csv_file_data, log_file);
 	
 	Log::write_to_console_and_quit("Finished!\n");
-}
\ No newline at end of file
+}
@@ -1,8 +1,17 @@
 #include "test.h"
+#include "AMRCuboid.h"
 #include "ConfFileData.h"
+#include "CSVFileData.h"
+#include "ChemSpecies.h"
+#include "Log.h"
+#include "PropertyTable.h"
+#include <cmath>
+#include <iomanip>
 #include <string>
+#include <sstream>
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 void conf_file_test(std::string path)
 {
@@ -15,4 +24,61 @@ void conf_file_test(std::string path)
 void log_test(std::ofstream& log_file)
 {
 	log_file << "Does this overwrite everything?\n";
-}
\ No newline at end of file
+}
+
+/*
+A hot spot in the middle of an adaptive cuboid mesh, with fixed properties and the faces held at the initial
+temperature, diffuses out of the refined region around it. Far from the faces no heat flows out of the cuboid, so
+the heat added must stay the same to rounding. Returns whether the test passed.
+*/
+bool amr_conservation_test(std::ofstream& log_file)
+{
+	std::istringstream settings("geometry=3\ncuboid_x_meshsize=129\ncuboid_y_meshsize=129\ncuboid_z_meshsize=129\n"
+		"amr_on=true\namr_block_size=4\nchemistry_on=false\n"
+		"fixed_thermal_conductivity=true\nfixed_specific_heat_capacity=true\n");
+	ConfFileData cf(settings);
+	CSVFileData csv_file_data(std::vector<ChemSpecies>{});
+	PropertyTable const& property_table = property_table_for(cf, log_file);
+	AMRCuboid amr(cf, csv_file_data, property_table);
+
+	// 100 Kelvin at the centre, falling off over one coarse spacing; the blocks around it are refined
+	double const initial_temp = cf._initial_temp + 273.15;
+	double const spacing = cf._x_length / (1000000 * (cf._x_meshsize - 1));
+	double const centre = (cf._x_meshsize - 1) / 2 * spacing;
+	double const width = 2 * spacing;
+	auto const hot_spot = [&](double const x, double const y, double const z)
+	{
+		double const r2 = (x - centre) * (x - centre) + (y - centre) * (y - centre) + (z - centre) * (z - centre);
+		return initial_temp + 100 * std::exp(-r2 / (2 * width * width));
+	};
+	amr.set_temperature(hot_spot);
+	size_t const refined_blocks = amr.regrid();
+	amr.set_temperature(hot_spot);
+
+	// 60 coarse timesteps at an eighth of the fine stability limit take the hot spot some way across the surface of
+	// the refined region, which is 8 coarse spacings from the centre, but not near the faces
+	double const dt = spacing * spacing / (8 * property_table.thermal_diffusivity(initial_temp));
+
+	// a coarse point 2 coarse spacings outside the refined region, which only warms if heat crosses its surface
+	size_t const half = (cf._x_meshsize - 1) / 4;
+	size_t const outside = ((half + 10) * amr.coarse_conf_file_data()._y_meshsize + half)
+		* amr.coarse_conf_file_data()._z_meshsize + half;
+
+	double const start = amr.heat_added();
+	for (size_t step = 0; step < 60; step++)
+	{
+		double sum_of_square_changes = 0.0;
+		bool non_finite = false;
+		amr.step(dt, 0.0, sum_of_square_changes, non_finite);
+	}
+	double const error = std::abs(amr.heat_added() - start) / start;
+	double const outside_rise = amr.coarse_temp()[outside] - initial_temp;
+
+	bool const passed = (error < 1e-9 and outside_rise > 0.01);
+	std::ostringstream message;
+	message << std::scientific << std::setprecision(3) << "AMR conservation test " << (passed ? "passed" : "failed")
+		<< ": " << refined_blocks << " blocks refined, the temperature outside the refined region rose by "
+		<< outside_rise << " K and the heat added changed by a fraction " << error << ".\n";
+	Log::write(log_file, message.str());
+	return passed;
+}
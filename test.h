@@ -3,4 +3,5 @@
 #include <fstream>
 
 void conf_file_test(std::string path);
-void log_test(std::ofstream& log_file);
\ No newline at end of file
+void log_test(std::ofstream& log_file);
+bool amr_conservation_test(std::ofstream& log_file);